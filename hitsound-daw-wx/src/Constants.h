@@ -14,7 +14,6 @@ namespace TrackLayout {
 
 namespace TimerIntervals {
     constexpr int PlaybackUpdate = 30;
-    constexpr int LoopCheck = 10;
 }
 
 namespace DefaultVolumes {
@@ -0,0 +1,75 @@
+#include "AllocationGuard.h"
+
+#if JUCE_DEBUG
+
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+namespace
+{
+    thread_local int noAllocationDepth = 0;
+
+    void checkHeapAccess()
+    {
+        if (noAllocationDepth > 0)
+        {
+            // Logging the assertion allocates, so lift the guard while it does
+            const int depth = std::exchange (noAllocationDepth, 0);
+            jassertfalse;  // Heap used on a thread that promised not to (usually the audio thread)
+            noAllocationDepth = depth;
+        }
+    }
+
+    void* allocate (std::size_t size)
+    {
+        checkHeapAccess();
+        return std::malloc (size == 0 ? 1 : size);
+    }
+
+    void release (void* ptr) noexcept
+    {
+        if (ptr != nullptr)
+            checkHeapAccess();
+
+        std::free (ptr);
+    }
+}
+
+ScopedNoAllocation::ScopedNoAllocation()  { ++noAllocationDepth; }
+ScopedNoAllocation::~ScopedNoAllocation() { --noAllocationDepth; }
+
+// Replacements for the global allocation functions. Only the non-aligned forms
+// are replaced; the aligned forms keep their default implementations, which
+// allocate directly rather than through these.
+void* operator new (std::size_t size)
+{
+    if (void* ptr = allocate (size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size)
+{
+    return operator new (size);
+}
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate (size);
+}
+
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate (size);
+}
+
+void operator delete (void* ptr) noexcept                               { release (ptr); }
+void operator delete[] (void* ptr) noexcept                             { release (ptr); }
+void operator delete (void* ptr, std::size_t) noexcept                  { release (ptr); }
+void operator delete[] (void* ptr, std::size_t) noexcept                { release (ptr); }
+void operator delete (void* ptr, const std::nothrow_t&) noexcept        { release (ptr); }
+void operator delete[] (void* ptr, const std::nothrow_t&) noexcept      { release (ptr); }
+
+#endif
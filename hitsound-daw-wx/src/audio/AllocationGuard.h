@@ -0,0 +1,19 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+// Debug-build check that realtime code never touches the heap.
+// While a ScopedNoAllocation is alive on a thread, any operator new or delete
+// on that thread hits a jassert. In release builds this compiles to nothing.
+class ScopedNoAllocation
+{
+public:
+#if JUCE_DEBUG
+    ScopedNoAllocation();
+    ~ScopedNoAllocation();
+#else
+    ScopedNoAllocation() {}
+#endif
+
+    JUCE_DECLARE_NON_COPYABLE (ScopedNoAllocation)
+};
@@ -4,6 +4,11 @@ AudioEngine::AudioEngine()
     : eventPlaybackSource(sampleRegistry)
 {
     formatManager.registerBasicFormats();
+
+    waveformBuilder.onUpdate = [this]
+    {
+        if (OnWaveformUpdated) OnWaveformUpdated();
+    };
 }
 
 AudioEngine::~AudioEngine()
@@ -11,28 +16,37 @@ AudioEngine::~AudioEngine()
     shutdown();
 }
 
-void AudioEngine::initialize()
+void AudioEngine::initialize(const AudioDeviceSettings& settings)
 {
     deviceManager.initialiseWithDefaultDevices(0, 2);
 
-    audioSourcePlayer.setSource(&mixer);
-    deviceManager.addAudioCallback(&audioSourcePlayer);
+    const bool hasSavedDevice = settings.deviceType.isNotEmpty() || settings.outputDevice.isNotEmpty()
+                             || settings.sampleRate > 0.0 || settings.bufferSize > 0;
+
+    // A saved device that has been unplugged or renamed leaves the default one open
+    if (hasSavedDevice && SetDeviceSettings(settings).failed())
+        deviceManager.initialiseWithDefaultDevices(0, 2);
 
-    mixer.addInputSource(&masterTransport, false);
-    mixer.addInputSource(&eventPlaybackSource, false);
+    readAheadThread.startThread();
 
     eventPlaybackSource.setTransportSource(&masterTransport);
-    eventPlaybackSource.setOffset(masterOffset);
+    eventPlaybackSource.setLevelMeters(&levelMeters);
+    UpdatePlaybackOffset();
 
-    startTimer(10);
+    audioSourcePlayer.setSource(&mixSource);
+    deviceManager.addAudioCallback(&audioSourcePlayer);
 }
 
 void AudioEngine::shutdown()
 {
-    stopTimer();
     deviceManager.removeAudioCallback(&audioSourcePlayer);
     audioSourcePlayer.setSource(nullptr);
-    mixer.removeAllInputs();
+
+    masterTransport.setSource(nullptr);
+    masterTrackSource.reset();
+    masterReaderSource.reset();
+    readAheadThread.stopThread(1000);
+    waveformBuilder.clear();
 }
 
 void AudioEngine::Start()
@@ -53,6 +67,7 @@ bool AudioEngine::IsPlaying() const
 void AudioEngine::SetPosition(double seconds)
 {
     masterTransport.setPosition(seconds - masterOffset);
+    eventPlaybackSource.seekTo(seconds - masterOffset);
 }
 
 double AudioEngine::GetPosition() const
@@ -65,9 +80,9 @@ double AudioEngine::GetDuration() const
     return masterTransport.getLengthInSeconds();
 }
 
-void AudioEngine::SetTracks(std::vector<Track>* tracks)
+void AudioEngine::SetProject(const Project* project)
 {
-    eventPlaybackSource.setTracks(tracks);
+    eventPlaybackSource.setProject(project);
 }
 
 void AudioEngine::NotifyTracksChanged()
@@ -77,20 +92,46 @@ void AudioEngine::NotifyTracksChanged()
 
 void AudioEngine::SetLooping(bool shouldLoop)
 {
-    looping = shouldLoop;
+    mixSource.setLooping(shouldLoop);
 }
 
 void AudioEngine::SetLoopPoints(double start, double end)
 {
-    loopStart = start;
-    loopEnd = end;
+    // The song plays at transport time, so the loop wraps where it is drawn
+    mixSource.setLoopRange(start, end);
+}
+
+void AudioEngine::SetLoopCrossfade(double seconds)
+{
+    mixSource.setLoopCrossfade(seconds);
+}
+
+void AudioEngine::LoadBeatmapSamples(const Project& project)
+{
+    // Files named directly by hitobjects, on top of the indexed ones the registry finds itself
+    juce::StringArray namedFiles;
+    std::function<void(const Track&)> collect = [&](const Track& track) {
+        if (!track.customFilename.empty())
+            namedFiles.addIfNotAlreadyThere(juce::String(track.customFilename));
+        for (const auto& child : track.children)
+            collect(child);
+    };
+
+    for (const auto& track : project.tracks)
+        collect(track);
+
+    sampleRegistry.loadBeatmapSamples(juce::File(juce::String(project.projectDirectory)), namedFiles);
 }
 
 void AudioEngine::LoadMasterTrack(const std::string& path)
 {
     masterTransport.stop();
     masterTransport.setSource(nullptr);
+    masterTrackSource.reset();
     masterReaderSource.reset();
+    masterTrackFile = juce::File();
+    waveformBuilder.clear();
+    eventPlaybackSource.seekTo(0.0);
 
     juce::File file(path);
     if (!file.existsAsFile())
@@ -99,75 +140,225 @@ void AudioEngine::LoadMasterTrack(const std::string& path)
         return;
     }
 
-    auto* reader = formatManager.createReaderFor(file);
-    if (reader)
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    if (!reader)
+    {
+        DBG("AudioEngine: Failed to create reader for: " + file.getFileName());
+        return;
+    }
+
+    masterTrackFile = file;
+    waveformBuilder.start(file);
+    const double sourceSampleRate = reader->sampleRate;
+
+    if (MasterTrackSource::canPreDecode(*reader))
     {
-        masterReaderSource.reset(new juce::AudioFormatReaderSource(reader, true));
-        masterTransport.setSource(masterReaderSource.get(), 0, nullptr, reader->sampleRate);
-        DBG("AudioEngine: Loaded master track: " + file.getFileName());
+        masterTrackSource = std::make_unique<MasterTrackSource>(std::move(reader));
+        masterTransport.setSource(masterTrackSource.get(), 0, nullptr, sourceSampleRate);
+        DBG("AudioEngine: Decoding master track into memory: " + file.getFileName());
     }
     else
     {
-        DBG("AudioEngine: Failed to create reader for: " + file.getFileName());
+        // Too long to keep in memory: stream it, decoding ahead on a background thread
+        const int readAheadSamples = (int)(sourceSampleRate * 4.0);
+        masterReaderSource = std::make_unique<juce::AudioFormatReaderSource>(reader.release(), true);
+        masterTransport.setSource(masterReaderSource.get(), readAheadSamples, &readAheadThread, sourceSampleRate);
+        DBG("AudioEngine: Streaming master track: " + file.getFileName());
     }
 }
 
-std::vector<float> AudioEngine::GetWaveform(int numSamples)
+double AudioEngine::GetMasterTrackLoadProgress() const
+{
+    return masterTrackSource ? masterTrackSource->getDecodeProgress() : 1.0;
+}
+
+std::shared_ptr<const WaveformPyramid> AudioEngine::GetWaveform() const
+{
+    return waveformBuilder.getPyramid();
+}
+
+void AudioEngine::SetWaveformCacheDirectory(const juce::File& directory)
 {
-    std::vector<float> peaks;
-    if (!masterReaderSource) return peaks;
+    waveformBuilder.setCacheDirectory(directory);
+}
+
+void AudioEngine::SetMasterVolume(float volume)
+{
+    masterTransport.setGain(volume);
+}
 
-    auto* reader = masterReaderSource->getAudioFormatReader();
-    if (!reader) return peaks;
+void AudioEngine::SetEffectsVolume(float volume)
+{
+    eventPlaybackSource.setMasterGain(volume);
+}
+
+float AudioEngine::GetMasterVolume() const
+{
+    return masterTransport.getGain();
+}
 
-    long long length = reader->lengthInSamples;
-    int channels = reader->numChannels;
+float AudioEngine::GetEffectsVolume() const
+{
+    return eventPlaybackSource.getMasterGain();
+}
 
-    if (length <= 0 || channels <= 0) return peaks;
+OfflineRenderer::Options AudioEngine::MakeRenderOptions(OfflineRenderer::Format format) const
+{
+    OfflineRenderer::Options options;
+    options.format = format;
+    options.content = masterTrackFile.existsAsFile() ? OfflineRenderer::Content::FullMix : OfflineRenderer::Content::HitsoundsOnly;
+    options.songFile = masterTrackFile;
+    options.songGain = GetMasterVolume();
+    options.hitsoundGain = GetEffectsVolume();
+    options.offsetSeconds = latencyTrim;
+    options.maxVoices = GetMaxVoices();
+    return options;
+}
 
-    long long chunkSize = length / numSamples;
-    if (chunkSize < 1) chunkSize = 1;
+juce::Result AudioEngine::ExportAudio(const Project& project, const juce::File& file,
+                                      OfflineRenderer::Format format, OfflineRenderer::Content content,
+                                      const OfflineRenderer::ProgressCallback& onProgress)
+{
+    auto options = MakeRenderOptions(format);
+    options.outputFile = file;
+    if (content == OfflineRenderer::Content::HitsoundsOnly)
+        options.content = content;
 
-    juce::AudioBuffer<float> buffer(channels, (int)chunkSize);
+    return OfflineRenderer::render(project, sampleRegistry, options, onProgress);
+}
 
-    long long position = 0;
-    for (int i = 0; i < numSamples; ++i)
-    {
-        reader->read(&buffer, 0, (int)chunkSize, position, true, true);
-
-        float maxVal = 0.0f;
-        for (int c = 0; c < channels; ++c)
-        {
-            auto range = buffer.findMinMax(c, 0, (int)chunkSize);
-            float currMax = std::max(std::abs(range.getStart()), std::abs(range.getEnd()));
-            if (currMax > maxVal) maxVal = currMax;
-        }
-        peaks.push_back(maxVal);
-
-        position += chunkSize;
-    }
+juce::Result AudioEngine::ExportStems(const Project& project, const juce::File& directory,
+                                      OfflineRenderer::Format format, const OfflineRenderer::ProgressCallback& onProgress)
+{
+    // The song only sets the stems' length, so they line up with it in a DAW
+    return OfflineRenderer::renderStems(project, sampleRegistry, directory, MakeRenderOptions(format), onProgress);
+}
 
-    return peaks;
+void AudioEngine::SetMaxVoices(int numVoices)
+{
+    eventPlaybackSource.setMaxVoices(numVoices);
 }
 
-void AudioEngine::hiResTimerCallback()
+int AudioEngine::GetMaxVoices() const
 {
-    if (looping && masterTransport.isPlaying() && loopStart >= 0 && loopEnd > loopStart)
+    return eventPlaybackSource.getMaxVoices();
+}
+
+AudioPerformanceStats AudioEngine::GetPerformanceStats()
+{
+    auto stats = performanceMonitor.takeStats();
+
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        stats.deviceXRuns = device->getXRunCount();
+
+    return stats;
+}
+
+void AudioEngine::ResetPerformanceStats()
+{
+    performanceMonitor.reset();
+}
+
+juce::StringArray AudioEngine::GetDeviceTypes()
+{
+    juce::StringArray names;
+    for (auto* type : deviceManager.getAvailableDeviceTypes())
+        names.add(type->getTypeName());
+    return names;
+}
+
+juce::StringArray AudioEngine::GetOutputDevices()
+{
+    auto* type = deviceManager.getCurrentDeviceTypeObject();
+    return type != nullptr ? type->getDeviceNames(false) : juce::StringArray();
+}
+
+juce::Array<double> AudioEngine::GetAvailableSampleRates()
+{
+    auto* device = deviceManager.getCurrentAudioDevice();
+    return device != nullptr ? device->getAvailableSampleRates() : juce::Array<double>();
+}
+
+juce::Array<int> AudioEngine::GetAvailableBufferSizes()
+{
+    auto* device = deviceManager.getCurrentAudioDevice();
+    return device != nullptr ? device->getAvailableBufferSizes() : juce::Array<int>();
+}
+
+AudioDeviceSettings AudioEngine::GetDeviceSettings()
+{
+    AudioDeviceSettings settings;
+    settings.deviceType = deviceManager.getCurrentAudioDeviceType();
+
+    if (auto* device = deviceManager.getCurrentAudioDevice())
     {
-        double currentPos = masterTransport.getCurrentPosition();
-        if (currentPos >= loopEnd - masterOffset)
-        {
-            masterTransport.setPosition(loopStart - masterOffset);
-        }
+        settings.outputDevice = device->getName();
+        settings.sampleRate = device->getCurrentSampleRate();
+        settings.bufferSize = device->getCurrentBufferSizeSamples();
     }
+
+    return settings;
 }
 
-void AudioEngine::SetMasterVolume(float volume)
+juce::Result AudioEngine::SetDeviceSettings(const AudioDeviceSettings& settings)
 {
-    masterTransport.setGain(volume);
+    // Switching backend opens its default device; the rest of the settings then apply to that
+    if (settings.deviceType.isNotEmpty() && settings.deviceType != deviceManager.getCurrentAudioDeviceType())
+        deviceManager.setCurrentAudioDeviceType(settings.deviceType, true);
+
+    auto setup = deviceManager.getAudioDeviceSetup();
+    setup.useDefaultOutputChannels = true;
+
+    if (settings.outputDevice.isNotEmpty())
+        setup.outputDeviceName = settings.outputDevice;
+    if (settings.sampleRate > 0.0)
+        setup.sampleRate = settings.sampleRate;
+    if (settings.bufferSize > 0)
+        setup.bufferSize = settings.bufferSize;
+
+    auto error = deviceManager.setAudioDeviceSetup(setup, true);
+    UpdatePlaybackOffset();
+
+    return error.isEmpty() ? juce::Result::ok() : juce::Result::fail(error);
 }
 
-void AudioEngine::SetEffectsVolume(float volume)
+double AudioEngine::GetOutputLatency()
 {
-    eventPlaybackSource.setMasterGain(volume);
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (device == nullptr || device->getCurrentSampleRate() <= 0.0)
+        return 0.0;
+
+    return device->getOutputLatencyInSamples() / device->getCurrentSampleRate();
+}
+
+void AudioEngine::SetLatencyTrim(double seconds)
+{
+    latencyTrim = seconds;
+    UpdatePlaybackOffset();
+}
+
+void AudioEngine::UpdatePlaybackOffset()
+{
+    masterOffset = -GetOutputLatency();
+    eventPlaybackSource.setOffset(latencyTrim);
+}
+
+MeterLevel AudioEngine::GetTrackLevel(int trackIndex) const
+{
+    return levelMeters.getTrackLevel(trackIndex);
+}
+
+MeterLevel AudioEngine::GetBusLevel(LevelMeters::Bus bus) const
+{
+    return levelMeters.getBusLevel(bus);
+}
+
+void AudioEngine::SetResampleQuality(ResampleQuality quality)
+{
+    sampleRegistry.setResampleQuality(quality);
+}
+
+ResampleQuality AudioEngine::GetResampleQuality() const
+{
+    return sampleRegistry.getResampleQuality();
 }
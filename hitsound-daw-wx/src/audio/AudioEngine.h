@@ -4,18 +4,35 @@
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_audio_formats/juce_audio_formats.h>
 #include "EventPlaybackSource.h"
+#include "TransportMixSource.h"
+#include "AudioPerformanceMonitor.h"
+#include "LevelMeters.h"
+#include "MasterTrackSource.h"
+#include "OfflineRenderer.h"
 #include "SampleRegistry.h"
-#include "../model/Track.h"
+#include "WaveformBuilder.h"
+#include "../model/Project.h"
+#include <functional>
 #include <memory>
 #include <vector>
 
-class AudioEngine : public juce::HighResolutionTimer
+// Output device choice. Empty names and zeros leave that part at the backend's default.
+struct AudioDeviceSettings
+{
+    juce::String deviceType;    // Backend, e.g. "ALSA" or "JACK"
+    juce::String outputDevice;
+    double sampleRate = 0.0;
+    int bufferSize = 0;
+};
+
+class AudioEngine
 {
 public:
     AudioEngine();
     ~AudioEngine();
 
-    void initialize();
+    // Opens the given device, falling back to the default one if it can't be opened
+    void initialize(const AudioDeviceSettings& settings = {});
     void shutdown();
 
     void Start();
@@ -25,40 +42,107 @@ public:
     double GetPosition() const;
     double GetDuration() const;
 
-    void hiResTimerCallback() override;
-
-    void SetTracks(std::vector<Track>* tracks);
+    void SetProject(const Project* project);
 
     // Call after modifying tracks from UI thread to sync with audio thread
     void NotifyTracksChanged();
 
+    // Loops wrap inside the audio callback at the exact sample
     void SetLooping(bool looping);
     void SetLoopPoints(double start, double end);
+    void SetLoopCrossfade(double seconds);
 
     SampleRegistry& GetSampleRegistry() { return sampleRegistry; }
 
+    // Loads the beatmap folder's custom samples in the background (see SampleRegistry)
+    void LoadBeatmapSamples(const Project& project);
+
+    // Songs are decoded into memory in the background (see MasterTrackSource);
+    // very long ones are streamed through a read-ahead buffer instead
     void LoadMasterTrack(const std::string& path);
-    std::vector<float> GetWaveform(int numSamples);
+    double GetMasterTrackLoadProgress() const;
+
+    // The master track's waveform, built in the background and cached on disk.
+    // Null until the song has been opened; bins fill in while it is being built.
+    std::shared_ptr<const WaveformPyramid> GetWaveform() const;
+    void SetWaveformCacheDirectory(const juce::File& directory);
+
+    // Called on the waveform builder thread whenever more of the waveform is ready
+    std::function<void()> OnWaveformUpdated;
 
     void SetMasterVolume(float volume);
     void SetEffectsVolume(float volume);
+    float GetMasterVolume() const;
+    float GetEffectsVolume() const;
+
+    // Bounces the song and hitsounds to a file with the current volumes and offset.
+    // Blocks the calling thread; see OfflineRenderer.
+    juce::Result ExportAudio(const Project& project, const juce::File& file,
+                             OfflineRenderer::Format format, OfflineRenderer::Content content,
+                             const OfflineRenderer::ProgressCallback& onProgress);
+
+    // One hitsound stem per top-level track, rendered in parallel into directory
+    juce::Result ExportStems(const Project& project, const juce::File& directory,
+                             OfflineRenderer::Format format, const OfflineRenderer::ProgressCallback& onProgress);
+
+    // Hitsound polyphony cap (see VoicePool)
+    void SetMaxVoices(int numVoices);
+    int GetMaxVoices() const;
+
+    // Audio callback timing since the last call (peaks reset on every read), plus the
+    // driver's own xrun count where it reports one
+    AudioPerformanceStats GetPerformanceStats();
+    void ResetPerformanceStats();
+
+    // Latest peak/RMS of a top-level track (by index) or of a bus; see LevelMeters
+    MeterLevel GetTrackLevel(int trackIndex) const;
+    MeterLevel GetBusLevel(LevelMeters::Bus bus) const;
+
+    // Output device. Changing it restarts the audio callback and re-derives the playback offset.
+    juce::StringArray GetDeviceTypes();
+    juce::StringArray GetOutputDevices();  // Of the current backend
+    juce::Array<double> GetAvailableSampleRates();
+    juce::Array<int> GetAvailableBufferSizes();
+    AudioDeviceSettings GetDeviceSettings();
+    juce::Result SetDeviceSettings(const AudioDeviceSettings& settings);
+
+    // Output latency reported by the open device, in seconds (0 with no device)
+    double GetOutputLatency();
+
+    // Shifts hitsounds against the song, live and in exports. A positive trim
+    // plays hitsounds earlier. The output latency only moves the playhead.
+    void SetLatencyTrim(double seconds);
+    double GetLatencyTrim() const { return latencyTrim; }
+    double GetPlaybackOffset() const { return masterOffset; }  // Playhead: -output latency
+
+    // Quality used when resampling hitsounds to the device rate
+    void SetResampleQuality(ResampleQuality quality);
+    ResampleQuality GetResampleQuality() const;
 
 private:
+    OfflineRenderer::Options MakeRenderOptions(OfflineRenderer::Format format) const;
+    void UpdatePlaybackOffset();
+
     juce::AudioDeviceManager deviceManager;
     juce::AudioSourcePlayer audioSourcePlayer;
-    juce::MixerAudioSource mixer;
     juce::AudioFormatManager formatManager;
 
     juce::AudioTransportSource masterTransport;
+    std::unique_ptr<MasterTrackSource> masterTrackSource;
     std::unique_ptr<juce::AudioFormatReaderSource> masterReaderSource;
+    juce::TimeSliceThread readAheadThread { "Song read-ahead" };
+    juce::File masterTrackFile;
+    WaveformBuilder waveformBuilder;
 
     SampleRegistry sampleRegistry;
     EventPlaybackSource eventPlaybackSource;
-
-    bool looping = false;
-    double loopStart = 0.0;
-    double loopEnd = 0.0;
-
-    // Latency compensation offset (seconds). Adjusts event playback to align with audio.
-    double masterOffset = -0.029;
+    AudioPerformanceMonitor performanceMonitor;
+    LevelMeters levelMeters;
+    TransportMixSource mixSource { masterTransport, eventPlaybackSource, performanceMonitor, levelMeters };
+
+    // Heard song time minus transport time (seconds): the output latency, negated.
+    // Only the playhead uses it; song and hitsounds share the device, so its
+    // latency delays both alike.
+    double masterOffset = 0.0;
+    double latencyTrim = 0.0;  // Hitsound time minus song time, see SetLatencyTrim
 };
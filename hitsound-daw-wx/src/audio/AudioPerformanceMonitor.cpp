@@ -0,0 +1,55 @@
+#include "AudioPerformanceMonitor.h"
+
+namespace
+{
+    // Weight of the newest callback in the smoothed load (about a 30 callback window)
+    constexpr float loadSmoothing = 0.07f;
+}
+
+void AudioPerformanceMonitor::prepare (double sampleRate)
+{
+    currentSampleRate.store (sampleRate);
+}
+
+void AudioPerformanceMonitor::record (juce::int64 startTicks, juce::int64 endTicks, int numSamples, int numVoices) noexcept
+{
+    const double seconds = juce::Time::highResolutionTicksToSeconds (endTicks - startTicks);
+    const double period = numSamples / currentSampleRate.load (std::memory_order_relaxed);
+    const float callbackLoad = period > 0.0 ? (float) (seconds / period) : 0.0f;
+
+    smoothedLoad += loadSmoothing * (callbackLoad - smoothedLoad);
+
+    load.store (smoothedLoad, std::memory_order_relaxed);
+    lastCallbackMs.store (seconds * 1000.0, std::memory_order_relaxed);
+    numCallbacks.fetch_add (1, std::memory_order_relaxed);
+
+    if (callbackLoad > 1.0f)
+        numOverruns.fetch_add (1, std::memory_order_relaxed);
+
+    // A reset from the UI landing between the load and the store is simply lost
+    if (callbackLoad > peakLoad.load (std::memory_order_relaxed))
+        peakLoad.store (callbackLoad, std::memory_order_relaxed);
+
+    if (numVoices > peakVoices.load (std::memory_order_relaxed))
+        peakVoices.store (numVoices, std::memory_order_relaxed);
+}
+
+AudioPerformanceStats AudioPerformanceMonitor::takeStats()
+{
+    AudioPerformanceStats stats;
+    stats.load = load.load (std::memory_order_relaxed);
+    stats.peakLoad = peakLoad.exchange (0.0f, std::memory_order_relaxed);
+    stats.lastCallbackMs = lastCallbackMs.load (std::memory_order_relaxed);
+    stats.peakVoices = peakVoices.exchange (0, std::memory_order_relaxed);
+    stats.numCallbacks = numCallbacks.load (std::memory_order_relaxed);
+    stats.numOverruns = numOverruns.load (std::memory_order_relaxed);
+    return stats;
+}
+
+void AudioPerformanceMonitor::reset()
+{
+    peakLoad.store (0.0f);
+    peakVoices.store (0);
+    numCallbacks.store (0);
+    numOverruns.store (0);
+}
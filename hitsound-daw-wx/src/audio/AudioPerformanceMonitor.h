@@ -0,0 +1,45 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <cstdint>
+
+// What the audio callback has been doing, as seen from the UI thread
+struct AudioPerformanceStats
+{
+    float load = 0.0f;            // Smoothed callback time / buffer period; 1.0 is the deadline
+    float peakLoad = 0.0f;        // Worst single callback since the last read
+    double lastCallbackMs = 0.0;
+    int peakVoices = 0;           // Most voices sounding in one callback since the last read
+    uint64_t numCallbacks = 0;
+    uint64_t numOverruns = 0;     // Callbacks that took longer than the audio they produced
+    int deviceXRuns = -1;         // Reported by the driver; -1 if it can't tell
+};
+
+// Times every audio callback. The audio thread only stores into atomics, so
+// measuring never blocks it; the UI polls takeStats() from a timer.
+class AudioPerformanceMonitor
+{
+public:
+    void prepare (double sampleRate);
+
+    // Audio thread: one call per callback, with the ticks taken at its start and end
+    void record (juce::int64 startTicks, juce::int64 endTicks, int numSamples, int numVoices) noexcept;
+
+    // Any thread. Clears the peaks, so each read covers the time since the last one.
+    AudioPerformanceStats takeStats();
+    void reset();
+
+private:
+    std::atomic<double> currentSampleRate { 44100.0 };
+
+    std::atomic<float> load { 0.0f };
+    std::atomic<float> peakLoad { 0.0f };
+    std::atomic<double> lastCallbackMs { 0.0 };
+    std::atomic<int> peakVoices { 0 };
+    std::atomic<uint64_t> numCallbacks { 0 };
+    std::atomic<uint64_t> numOverruns { 0 };
+
+    // Audio thread only
+    float smoothedLoad = 0.0f;
+};
@@ -1,214 +1,141 @@
 #include "EventPlaybackSource.h"
+#include "AllocationGuard.h"
 
 EventPlaybackSource::EventPlaybackSource (SampleRegistry& registry)
-    : sampleRegistry (registry), offsetSeconds(0.0)
+    : sampleRegistry (registry)
 {
 }
 
 void EventPlaybackSource::setOffset(double offset)
 {
-    offsetSeconds = offset;
+    offsetSeconds.store(offset);
+}
+
+void EventPlaybackSource::seekTo (double transportSeconds)
+{
+    pendingSeekSeconds.store (juce::jmax (0.0, transportSeconds));
 }
 
 EventPlaybackSource::~EventPlaybackSource()
 {
+    // The audio thread has stopped by now, so whatever it still owns can go here
+    delete schedule;
+
+    for (int i = 0; i < numReplacedSchedules; ++i)
+        delete replacedSchedules[(size_t) i].schedule;
 }
 
 void EventPlaybackSource::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
 {
     currentSampleRate = sampleRate;
+
+    // Resampling to the new rate happens in the background. Trigger positions are
+    // in device samples too, but the project may only be read on the message
+    // thread, so the schedule is recompiled there once the registry reports the
+    // new buffers (onSamplesRendered). Until then the published one keeps playing.
+    voices.clear();
+    sampleRegistry.setSampleRate (sampleRate);
+
+    if (transportSource != nullptr)
+        seekTo (transportSource->getCurrentPosition());
 }
 
 void EventPlaybackSource::releaseResources()
 {
-    activeVoices.clear();
+    voices.clear();
 }
 
 void EventPlaybackSource::getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    const juce::SpinLock::ScopedLockType lock (tracksLock);
+    const ScopedNoAllocation noAllocation;
 
-    if (tracksSnapshot.empty() || transportSource == nullptr)
-    {
-        bufferToFill.clearActiveBufferRegion();
+    retireFinishedSchedules();
+    takeLatestSchedule();
+
+    bufferToFill.clearActiveBufferRegion();
+
+    if (transportSource == nullptr)
         return;
-    }
 
-    auto currentPos = transportSource->getCurrentPosition() + offsetSeconds;
-    auto currentSample = (int64_t) (currentPos * currentSampleRate);
-    auto numSamples = bufferToFill.numSamples;
-    auto endSample = currentSample + numSamples;
-
-    // Check if any track is soloed
-    bool anySolo = false;
-    std::function<void(const Track&)> checkSolo = [&](const Track& t) {
-        if (t.solo) anySolo = true;
-        for (const auto& child : t.children) checkSolo(child);
-    };
-    for (const auto& t : tracksSnapshot) checkSolo(t);
-
-    // Process each track and trigger samples
-    std::function<void(const Track&)> processTrack = [&](const Track& track)
-    {
-        if (track.mute || (anySolo && !track.solo))
-            return;
+    const auto numSamples = bufferToFill.numSamples;
 
-        if (!track.isGrouping)
-        {
-            for (const auto& event : track.events)
-            {
-                auto eventStartSample = (int64_t) (event.time * currentSampleRate);
-
-                if (eventStartSample >= currentSample && eventStartSample < endSample)
-                {
-                    auto playSample = [&](SampleSet bank, SampleType type) {
-                        SampleRef ref;
-                        ref.set = bank;
-                        ref.type = type;
-
-                        auto* reader = sampleRegistry.getReader (ref);
-                        if (reader != nullptr)
-                        {
-                            int startOffset = (int) (eventStartSample - currentSample);
-                            activeVoices.emplace_back (Voice { reader, 0, (double)reader->sampleRate / currentSampleRate, (float)(track.gain * event.volume), startOffset });
-                        }
-                    };
-
-                    if (track.layers.empty())
-                    {
-                        playSample(track.sampleSet, track.sampleType);
-                    }
-                    else
-                    {
-                        for (const auto& layer : track.layers)
-                        {
-                            playSample(layer.bank, layer.type);
-                        }
-                    }
-                }
-            }
-        }
-        else
-        {
-            // Grouping: trigger child samples on parent's events
-            for (const auto& event : track.events)
-            {
-                auto eventStartSample = (int64_t) (event.time * currentSampleRate);
-
-                if (eventStartSample >= currentSample && eventStartSample < endSample)
-                {
-                    for (const auto& child : track.children)
-                    {
-                        if (child.mute) continue;
-
-                        auto playSample = [&](SampleSet bank, SampleType type) {
-                            SampleRef ref;
-                            ref.set = bank;
-                            ref.type = type;
-
-                            auto* reader = sampleRegistry.getReader (ref);
-                            if (reader != nullptr)
-                            {
-                                int startOffset = (int) (eventStartSample - currentSample);
-                                float combinedGain = (float)(track.gain * child.gain * event.volume);
-                                activeVoices.emplace_back (Voice { reader, 0, (double)reader->sampleRate / currentSampleRate, combinedGain, startOffset });
-                            }
-                        };
-
-                        if (child.layers.empty())
-                        {
-                            playSample(child.sampleSet, child.sampleType);
-                        }
-                        else
-                        {
-                            for (const auto& layer : child.layers)
-                            {
-                                playSample(layer.bank, layer.type);
-                            }
-                        }
-                    }
-                }
-            }
-        }
+    const double seekSeconds = pendingSeekSeconds.exchange (noPendingSeek);
+    if (seekSeconds >= 0.0)
+        transportSample = (int64_t) std::llround (seekSeconds * currentSampleRate);
+
+    // Nothing is triggered while stopped; voices already sounding ring out
+    const bool playing = transportSource->isPlaying();
+    const float master = masterGain.load (std::memory_order_relaxed);
+
+    if (playing && schedule != nullptr)
+    {
+        const auto startSample = transportSample + (int64_t) std::llround (offsetSeconds.load() * currentSampleRate);
+        const auto endSample = startSample + numSamples;
 
-        for (const auto& child : track.children)
+        // Re-seek the cursor after a new schedule, a seek or an offset change
+        if (scheduleChanged || seekSeconds >= 0.0 || startSample != expectedBlockStart)
         {
-            processTrack (child);
+            cursor = schedule->findFirstTriggerAt (startSample);
+            scheduleChanged = false;
         }
-    };
+        expectedBlockStart = endSample;
 
-    for (const auto& track : tracksSnapshot)
-    {
-        processTrack (track);
+        cursor = voices.startTriggers (*schedule, cursor, startSample, numSamples, master);
     }
 
-    // Mix active voices into output buffer
-    bufferToFill.clearActiveBufferRegion();
+    if (playing)
+        transportSample += numSamples;
 
-    for (auto it = activeVoices.begin(); it != activeVoices.end();)
-    {
-        auto& voice = *it;
-        bool finished = false;
-
-        int destOffset = 0;
-        int count = numSamples;
+    peakVoices = juce::jmax (peakVoices, voices.size());
+    voices.render (bufferToFill.buffer, bufferToFill.startSample, numSamples, master, levelMeters);
+}
 
-        if (voice.startOffset > 0)
-        {
-            destOffset = voice.startOffset;
-            count -= voice.startOffset;
-            voice.startOffset = 0;
-        }
+void EventPlaybackSource::takeLatestSchedule()
+{
+    // With no room to park the current schedule, keep playing it for another block
+    if (numReplacedSchedules == (int) replacedSchedules.size())
+        return;
 
-        if (count > 0)
-        {
-            juce::AudioBuffer<float> tempBuffer (2, count);
-
-            if (voice.reader->read (&tempBuffer, 0, count, voice.position, true, true))
-            {
-                tempBuffer.applyGain(voice.gain * masterGain);
-
-                for (int ch = 0; ch < bufferToFill.buffer->getNumChannels(); ++ch)
-                {
-                    int sourceCh = ch % tempBuffer.getNumChannels();
-                    bufferToFill.buffer->addFrom (ch, bufferToFill.startSample + destOffset, tempBuffer, sourceCh, 0, count);
-                }
-
-                voice.position += count;
-
-                if (voice.position >= voice.reader->lengthInSamples)
-                    finished = true;
-            }
-            else
-            {
-                finished = true;
-            }
-        }
+    if (auto* next = schedulePublisher.takeLatest())
+    {
+        if (schedule != nullptr)
+            replacedSchedules[(size_t) numReplacedSchedules++] = { schedule, voices.getNextStartOrder() };
 
-        if (finished)
-            it = activeVoices.erase (it);
-        else
-            ++it;
+        schedule = next;
+        scheduleChanged = true;
     }
 }
 
-void EventPlaybackSource::setTracks (std::vector<Track>* t)
+void EventPlaybackSource::retireFinishedSchedules()
 {
-    uiTracks = t;
+    const auto oldestVoice = voices.getOldestStartOrder();
 
-    if (uiTracks != nullptr)
+    for (int i = 0; i < numReplacedSchedules;)
     {
-        const juce::SpinLock::ScopedLockType lock (tracksLock);
-        tracksSnapshot = *uiTracks;
+        auto& replaced = replacedSchedules[(size_t) i];
+
+        if (oldestVoice >= replaced.voicesStartedBefore && schedulePublisher.retire (replaced.schedule))
+            replaced = replacedSchedules[(size_t) --numReplacedSchedules];
+        else
+            ++i;
     }
 }
 
+void EventPlaybackSource::setProject (const Project* p)
+{
+    uiProject = p;
+    updateTracksSnapshot();
+}
+
 void EventPlaybackSource::updateTracksSnapshot()
 {
-    if (uiTracks == nullptr) return;
+    auto newSchedule = std::make_unique<PlaybackSchedule>();
+
+    if (uiProject != nullptr)
+        *newSchedule = PlaybackSchedule::compile (*uiProject, sampleRegistry, sampleRegistry.getSampleRate());
 
-    const juce::SpinLock::ScopedLockType lock (tracksLock);
-    tracksSnapshot = *uiTracks;
+    // Also frees schedules the audio thread has finished with
+    schedulePublisher.publish (std::move (newSchedule));
 }
 
 void EventPlaybackSource::setTransportSource (juce::AudioTransportSource* transport)
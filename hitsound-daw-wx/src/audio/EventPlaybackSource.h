@@ -2,8 +2,13 @@
 
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_audio_devices/juce_audio_devices.h>
-#include "../model/Track.h"
+#include "../model/Project.h"
 #include "SampleRegistry.h"
+#include "PlaybackSchedule.h"
+#include "RealtimePublisher.h"
+#include "VoicePool.h"
+#include <array>
+#include <utility>
 
 class EventPlaybackSource : public juce::AudioSource
 {
@@ -15,39 +20,77 @@ public:
     void releaseResources() override;
     void getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill) override;
 
-    void setTracks (std::vector<Track>* tracks);
+    void setProject (const Project* project);
 
-    // Call from UI thread after modifying tracks. Creates thread-safe snapshot.
+    // Call from UI thread after modifying tracks or once samples have been rendered
+    // at a new rate. Compiles a new playback schedule at the registry's rate.
     void updateTracksSnapshot();
 
     void setTransportSource (juce::AudioTransportSource* transport);
     void setOffset(double offset);
-    void setMasterGain(float gain) { masterGain = gain; }
+
+    // Call whenever the transport is moved (seek, loop wrap, new song). The event
+    // clock re-syncs to this transport position at the start of the next block.
+    void seekTo (double transportSeconds);
+    void setMasterGain(float gain) { masterGain.store(gain, std::memory_order_relaxed); }
+    float getMasterGain() const { return masterGain.load (std::memory_order_relaxed); }
+
+    // Maximum simultaneous voices; further triggers steal the quietest voice
+    void setMaxVoices (int numVoices) { voices.setPolyphony (numVoices); }
+    int getMaxVoices() const { return voices.getPolyphony(); }
+
+    // Audio thread: most voices sounding in any block since the last call
+    int takePeakVoices() noexcept { return std::exchange (peakVoices, 0); }
+
+    // Per-track levels of the voices are added here; set before playback starts
+    void setLevelMeters (LevelMeters* meters) { levelMeters = meters; }
 
 private:
     SampleRegistry& sampleRegistry;
 
-    // UI thread's track pointer (not accessed on audio thread)
-    std::vector<Track>* uiTracks { nullptr };
+    // UI thread's project (not accessed on audio thread)
+    const Project* uiProject { nullptr };
+
+    // Immutable compiled schedules, built on the UI thread and handed over without locks
+    RealtimePublisher<PlaybackSchedule> schedulePublisher;
+
+    // Current schedule, owned by the audio thread until retired
+    PlaybackSchedule* schedule { nullptr };
+    bool scheduleChanged { true };
+
+    // Replaced schedules whose samples may still be playing. Each is handed back
+    // for deletion once every voice started before it was replaced has finished.
+    struct ReplacedSchedule
+    {
+        PlaybackSchedule* schedule;
+        uint64_t voicesStartedBefore;
+    };
+
+    std::array<ReplacedSchedule, 8> replacedSchedules {};
+    int numReplacedSchedules { 0 };
+
+    // Audio thread playback cursor into the schedule
+    size_t cursor { 0 };
+    int64_t expectedBlockStart { -1 };
 
-    // Thread-safe snapshot for audio thread
-    std::vector<Track> tracksSnapshot;
-    juce::SpinLock tracksLock;
+    // Audio thread event clock: transport position in device samples. It advances
+    // by exactly numSamples per block while the transport plays and only jumps
+    // when a seek has been requested, so triggers can't be dropped or doubled.
+    int64_t transportSample { 0 };
+
+    static constexpr double noPendingSeek = -1.0;
+    std::atomic<double> pendingSeekSeconds { 0.0 };
 
     juce::AudioTransportSource* transportSource { nullptr };
 
     double currentSampleRate { 44100.0 };
-    double offsetSeconds { 0.0 };
-    float masterGain { 0.6f };
+    std::atomic<double> offsetSeconds { 0.0 };
+    std::atomic<float> masterGain { 0.6f };
 
-    struct Voice
-    {
-        juce::AudioFormatReader* reader;
-        int64_t position;
-        double speedRatio;
-        float gain;
-        int startOffset;  // Samples to delay before starting playback
-    };
+    VoicePool voices;
+    int peakVoices { 0 };
+    LevelMeters* levelMeters { nullptr };
 
-    std::vector<Voice> activeVoices;
+    void takeLatestSchedule();
+    void retireFinishedSchedules();
 };
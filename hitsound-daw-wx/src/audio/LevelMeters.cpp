@@ -0,0 +1,105 @@
+#include "LevelMeters.h"
+
+namespace
+{
+    // Four independent sums so the compiler can keep them in one SIMD register
+    float sumOfSquares (const float* samples, int numSamples) noexcept
+    {
+        float sums[4] = {};
+        int i = 0;
+
+        for (; i + 4 <= numSamples; i += 4)
+            for (int lane = 0; lane < 4; ++lane)
+                sums[lane] += samples[i + lane] * samples[i + lane];
+
+        for (; i < numSamples; ++i)
+            sums[0] += samples[i] * samples[i];
+
+        return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    }
+}
+
+void LevelMeters::prepare (double sampleRate)
+{
+    windowLength = juce::jmax (1, (int) std::lround (windowSeconds * sampleRate));
+    windowPosition = 0;
+
+    trackPeaks.fill (0.0f);
+    trackWindowPeaks.fill (0.0f);
+    trackSums.fill (0.0f);
+    busPeaks.fill (0.0f);
+    busSums.fill (0.0f);
+}
+
+void LevelMeters::addBus (Bus bus, const juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+{
+    const int numChannels = buffer.getNumChannels();
+
+    if (numChannels == 0 || numSamples <= 0)
+        return;
+
+    float peak = busPeaks[(size_t) bus];
+    float sum = 0.0f;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const float* samples = buffer.getReadPointer (ch, startSample);
+        const auto range = juce::FloatVectorOperations::findMinAndMax (samples, numSamples);
+
+        peak = juce::jmax (peak, -range.getStart(), range.getEnd());
+        sum += sumOfSquares (samples, numSamples);
+    }
+
+    busPeaks[(size_t) bus] = peak;
+    busSums[(size_t) bus] += sum / (float) numChannels;
+}
+
+void LevelMeters::endBlock (int numSamples) noexcept
+{
+    for (size_t i = 0; i < trackPeaks.size(); ++i)
+    {
+        trackWindowPeaks[i] = juce::jmax (trackWindowPeaks[i], trackPeaks[i]);
+        trackPeaks[i] = 0.0f;
+    }
+
+    windowPosition += numSamples;
+
+    if (windowPosition < windowLength)
+        return;
+
+    for (size_t i = 0; i < trackSlots.size(); ++i)
+        trackSlots[i].publish (trackWindowPeaks[i], trackSums[i], windowPosition);
+
+    for (size_t i = 0; i < busSlots.size(); ++i)
+        busSlots[i].publish (busPeaks[i], busSums[i], windowPosition);
+
+    trackWindowPeaks.fill (0.0f);
+    trackSums.fill (0.0f);
+    busPeaks.fill (0.0f);
+    busSums.fill (0.0f);
+    windowPosition = 0;
+}
+
+MeterLevel LevelMeters::getTrackLevel (int track) const
+{
+    if (track < 0 || track >= maxTracks)
+        return {};
+
+    return trackSlots[(size_t) track].load();
+}
+
+MeterLevel LevelMeters::getBusLevel (Bus bus) const
+{
+    return busSlots[(size_t) bus].load();
+}
+
+void LevelMeters::Slot::publish (float newPeak, float sumOfSquares, int numSamples) noexcept
+{
+    peak.store (newPeak, std::memory_order_relaxed);
+    rms.store (std::sqrt (sumOfSquares / (float) numSamples), std::memory_order_relaxed);
+}
+
+MeterLevel LevelMeters::Slot::load() const
+{
+    return { peak.load (std::memory_order_relaxed), rms.load (std::memory_order_relaxed) };
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <atomic>
+
+struct MeterLevel
+{
+    float peak = 0.0f;  // Linear, 1.0 is full scale
+    float rms = 0.0f;
+};
+
+// Peak/RMS levels of every top-level track and of the song, effects and master
+// buses. The audio thread accumulates each block into plain members and, once
+// per window, publishes the window's levels with relaxed atomic stores. It is
+// the only writer, so metering never waits on the UI; the UI just loads the
+// latest window whenever it repaints.
+//
+// Bus levels are measured from the mixed audio. Track levels are summed from
+// each voice's precomputed CachedSample levels scaled by its gain, so they cost
+// nothing per sample; the peak is the sum of the voices' peaks, an upper bound
+// when a track plays several voices at once.
+class LevelMeters
+{
+public:
+    static constexpr int maxTracks = 128;  // Tracks past this are not metered
+
+    enum Bus { songBus, effectsBus, masterBus, numBuses };
+
+    // Longer than the UI refresh interval, so no window goes unseen
+    static constexpr double windowSeconds = 0.05;
+
+    void prepare (double sampleRate);
+
+    // Audio thread
+    void addVoice (int track, float peak, float sumOfSquares) noexcept
+    {
+        if (track >= 0 && track < maxTracks)
+        {
+            trackPeaks[(size_t) track] += peak;
+            trackSums[(size_t) track] += sumOfSquares;
+        }
+    }
+
+    void addBus (Bus bus, const juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept;
+    void endBlock (int numSamples) noexcept;
+
+    // Any thread
+    MeterLevel getTrackLevel (int track) const;
+    MeterLevel getBusLevel (Bus bus) const;
+
+private:
+    struct Slot
+    {
+        std::atomic<float> peak { 0.0f };
+        std::atomic<float> rms { 0.0f };
+
+        void publish (float newPeak, float sumOfSquares, int numSamples) noexcept;
+        MeterLevel load() const;
+    };
+
+    std::array<Slot, maxTracks> trackSlots;
+    std::array<Slot, numBuses> busSlots;
+
+    // Audio thread: the window being accumulated. Track peaks are summed per
+    // block and the window keeps the largest block sum.
+    std::array<float, maxTracks> trackPeaks {};
+    std::array<float, maxTracks> trackWindowPeaks {};
+    std::array<float, maxTracks> trackSums {};
+    std::array<float, numBuses> busPeaks {};
+    std::array<float, numBuses> busSums {};
+    int windowLength = 2205;
+    int windowPosition = 0;
+};
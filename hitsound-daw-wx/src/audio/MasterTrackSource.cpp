@@ -0,0 +1,80 @@
+#include "MasterTrackSource.h"
+
+bool MasterTrackSource::canPreDecode (const juce::AudioFormatReader& reader)
+{
+    return reader.sampleRate > 0.0
+        && reader.lengthInSamples > 0
+        && (double) reader.lengthInSamples / reader.sampleRate <= maxPreDecodeSeconds;
+}
+
+MasterTrackSource::MasterTrackSource (std::unique_ptr<juce::AudioFormatReader> readerToUse)
+    : juce::Thread ("Song decoder"),
+      reader (std::move (readerToUse)),
+      buffer ((int) juce::jlimit (1u, 2u, reader->numChannels), (int) reader->lengthInSamples),
+      totalLength (reader->lengthInSamples)
+{
+    startThread();
+}
+
+MasterTrackSource::~MasterTrackSource()
+{
+    stopThread (5000);
+}
+
+double MasterTrackSource::getDecodeProgress() const
+{
+    return totalLength > 0 ? (double) decodedSamples.load() / (double) totalLength : 1.0;
+}
+
+void MasterTrackSource::run()
+{
+    // About a second per read keeps the first seconds available almost immediately
+    const int chunkSize = juce::jmax (4096, (int) reader->sampleRate);
+    const bool useRight = buffer.getNumChannels() > 1;
+
+    juce::int64 position = 0;
+
+    while (position < totalLength && ! threadShouldExit())
+    {
+        const int count = (int) juce::jmin ((juce::int64) chunkSize, totalLength - position);
+
+        if (! reader->read (&buffer, (int) position, count, position, true, useRight))
+        {
+            DBG("MasterTrackSource: Decode failed at sample " + juce::String (position));
+            buffer.clear ((int) position, (int) (totalLength - position));
+            position = totalLength;
+        }
+        else
+        {
+            position += count;
+        }
+
+        decodedSamples.store (position, std::memory_order_release);
+    }
+}
+
+void MasterTrackSource::setNextReadPosition (juce::int64 newPosition)
+{
+    readPosition.store (juce::jmax ((juce::int64) 0, newPosition));
+}
+
+void MasterTrackSource::getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    auto position = readPosition.load();
+    const auto decoded = decodedSamples.load (std::memory_order_acquire);
+
+    // Anything not decoded yet (or past the end) plays as silence
+    const int available = (int) juce::jlimit ((juce::int64) 0, (juce::int64) bufferToFill.numSamples, decoded - position);
+
+    for (int ch = 0; ch < bufferToFill.buffer->getNumChannels(); ++ch)
+    {
+        if (available > 0)
+            bufferToFill.buffer->copyFrom (ch, bufferToFill.startSample, buffer, ch % buffer.getNumChannels(), (int) position, available);
+
+        if (available < bufferToFill.numSamples)
+            bufferToFill.buffer->clear (ch, bufferToFill.startSample + available, bufferToFill.numSamples - available);
+    }
+
+    // Only advance if nobody seeked in the meantime
+    readPosition.compare_exchange_strong (position, position + bufferToFill.numSamples);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <atomic>
+#include <memory>
+
+// The song, decoded into RAM on a worker thread.
+// Playback can start straight away: whatever hasn't been decoded yet plays
+// as silence, and the decoder runs far ahead of realtime. Once a region is
+// decoded, seeking into it or looping over it is just a pointer move.
+class MasterTrackSource : public juce::PositionableAudioSource,
+                          private juce::Thread
+{
+public:
+    // Songs longer than this are streamed with a read-ahead buffer instead
+    static constexpr double maxPreDecodeSeconds = 20.0 * 60.0;
+    static bool canPreDecode (const juce::AudioFormatReader& reader);
+
+    explicit MasterTrackSource (std::unique_ptr<juce::AudioFormatReader> reader);
+    ~MasterTrackSource() override;
+
+    // 0..1, safe from any thread
+    double getDecodeProgress() const;
+
+    void prepareToPlay (int, double) override {}
+    void releaseResources() override {}
+    void getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition (juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override { return readPosition.load(); }
+    juce::int64 getTotalLength() const override { return totalLength; }
+    bool isLooping() const override { return false; }
+
+private:
+    std::unique_ptr<juce::AudioFormatReader> reader;  // Only touched by the decoder thread
+    juce::AudioBuffer<float> buffer;                  // Allocated up front, filled front to back
+    const juce::int64 totalLength;
+
+    std::atomic<juce::int64> decodedSamples { 0 };
+    std::atomic<juce::int64> readPosition { 0 };
+
+    void run() override;
+
+    JUCE_DECLARE_NON_COPYABLE (MasterTrackSource)
+};
@@ -0,0 +1,63 @@
+#include "MixKernel.h"
+
+namespace MixKernel
+{
+    void GainRamp::reset (float newGain) noexcept
+    {
+        gain = target = newGain;
+        step = 0.0f;
+        samplesLeft = 0;
+    }
+
+    void GainRamp::setTarget (float newTarget) noexcept
+    {
+        if (newTarget == target)
+            return;
+
+        target = newTarget;
+        step = (target - gain) / (float) gainRampLength;
+        samplesLeft = gainRampLength;
+    }
+
+    void GainRamp::advance (int numSamples) noexcept
+    {
+        if (numSamples <= 0 || samplesLeft == 0)
+            return;
+
+        samplesLeft = juce::jmax (0, samplesLeft - numSamples);
+
+        // Measured back from the target, so the last sample is exact rather than accumulated
+        gain = samplesLeft == 0 ? target : target - step * (float) samplesLeft;
+
+        if (samplesLeft == 0)
+            step = 0.0f;
+    }
+
+    void addWithGainRamp (float* dest, const float* source, int numSamples, const GainRamp& ramp) noexcept
+    {
+        if (numSamples <= 0)
+            return;
+
+        const int numRamp = juce::jmin (numSamples, ramp.samplesLeft);
+
+        for (int i = 0; i < numRamp; ++i)
+            dest[i] += source[i] * (ramp.gain + ramp.step * (float) (i + 1));
+
+        if (numSamples > numRamp && ramp.target != 0.0f)
+            juce::FloatVectorOperations::addWithMultiply (dest + numRamp, source + numRamp, ramp.target, numSamples - numRamp);
+    }
+
+    void mixVoice (juce::AudioBuffer<float>& dest, int destStart,
+                   const juce::AudioBuffer<float>& source, int sourceStart,
+                   int numSamples, GainRamp& ramp) noexcept
+    {
+        for (int ch = 0; ch < dest.getNumChannels(); ++ch)
+        {
+            addWithGainRamp (dest.getWritePointer (ch, destStart),
+                             source.getReadPointer (ch % source.getNumChannels(), sourceStart),
+                             numSamples, ramp);
+        }
+
+        ramp.advance (numSamples);
+    }
+}
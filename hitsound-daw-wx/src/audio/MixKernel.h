@@ -0,0 +1,41 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+// Voice mixing kernel. Reading a voice's sample, applying its gain and adding
+// it into the output happen in a single pass per output channel; the steady
+// part of the gain goes through juce::FloatVectorOperations (SSE/AVX/NEON).
+namespace MixKernel
+{
+    // Gain changes are spread over this many samples (about 1.3 ms at 48 kHz)
+    constexpr int gainRampLength = 64;
+
+    // A voice's output gain. A new target starts a ramp with a fixed step and
+    // sample count, so the ramp stays linear however the blocks split it and
+    // lands exactly on the target after gainRampLength samples.
+    struct GainRamp
+    {
+        float gain = 0.0f;    // Reached at the end of the last block
+        float target = 0.0f;
+        float step = 0.0f;
+        int samplesLeft = 0;
+
+        // Jumps straight to newGain, e.g. when a voice starts
+        void reset (float newGain) noexcept;
+
+        // Starts a ramp from the current gain, unless already heading there
+        void setTarget (float newTarget) noexcept;
+
+        void advance (int numSamples) noexcept;
+    };
+
+    // Adds source * gain into dest, following the ramp from its current state.
+    // Does not advance the ramp.
+    void addWithGainRamp (float* dest, const float* source, int numSamples, const GainRamp& ramp) noexcept;
+
+    // Mixes numSamples of source into every channel of dest, then advances the
+    // ramp. Source channels wrap, so a mono sample feeds both sides of a stereo output.
+    void mixVoice (juce::AudioBuffer<float>& dest, int destStart,
+                   const juce::AudioBuffer<float>& source, int sourceStart,
+                   int numSamples, GainRamp& ramp) noexcept;
+}
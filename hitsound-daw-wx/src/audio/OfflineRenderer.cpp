@@ -0,0 +1,369 @@
+#include "OfflineRenderer.h"
+#include "PlaybackSchedule.h"
+
+namespace
+{
+    constexpr int blockSize = 512;
+    constexpr int blocksPerChunk = 1024;  // About 12 s at 44.1 kHz
+    constexpr int songPreRoll = 4096;     // Settles the song's resampler before each chunk starts
+    constexpr int numOutputChannels = 2;
+    constexpr int bitsPerSample = 24;
+
+    // Where the hitsounds stand at the start of a chunk
+    struct ChunkStart
+    {
+        VoicePool voices;
+        size_t cursor = 0;
+    };
+
+    struct Chunk
+    {
+        juce::int64 start = 0;
+        int numSamples = 0;
+        juce::AudioBuffer<float> buffer;
+        juce::WaitableEvent done;
+    };
+
+    // Pulls [start, start + numSamples) of the song, at the render rate, into dest.
+    // Each chunk opens its own reader so chunks can decode in parallel.
+    void renderSong (juce::AudioBuffer<float>& dest, const juce::File& songFile, double sampleRate,
+                     juce::int64 start, int numSamples)
+    {
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+
+        auto* reader = formatManager.createReaderFor (songFile);
+        if (reader == nullptr)
+            return;
+
+        const double sourceSampleRate = reader->sampleRate;
+        juce::AudioFormatReaderSource readerSource (reader, true);
+        juce::AudioTransportSource transport;
+        transport.setSource (&readerSource, 0, nullptr, sourceSampleRate);
+        transport.prepareToPlay (blockSize, sampleRate);
+
+        const int preRoll = (int) juce::jmin ((juce::int64) songPreRoll, start);
+        transport.setPosition ((double) (start - preRoll) / sampleRate);
+        transport.start();
+
+        juce::AudioBuffer<float> scratch (numOutputChannels, blockSize);
+        for (int done = 0; done < preRoll; done += blockSize)
+            transport.getNextAudioBlock (juce::AudioSourceChannelInfo (&scratch, 0, juce::jmin (blockSize, preRoll - done)));
+
+        for (int done = 0; done < numSamples; done += blockSize)
+            transport.getNextAudioBlock (juce::AudioSourceChannelInfo (&dest, done, juce::jmin (blockSize, numSamples - done)));
+
+        transport.setSource (nullptr);
+    }
+
+    void renderChunk (Chunk& chunk, ChunkStart& state, const PlaybackSchedule& schedule,
+                      const OfflineRenderer::Options& options, double sampleRate, juce::int64 offsetSamples)
+    {
+        chunk.buffer.setSize (numOutputChannels, chunk.numSamples);
+        chunk.buffer.clear();
+
+        if (options.content == OfflineRenderer::Content::FullMix)
+        {
+            // Gain is applied here rather than by the transport, whose gain ramps at every start
+            renderSong (chunk.buffer, options.songFile, sampleRate, chunk.start, chunk.numSamples);
+            chunk.buffer.applyGain (options.songGain);
+        }
+
+        for (int offset = 0; offset < chunk.numSamples; offset += blockSize)
+        {
+            const int num = juce::jmin (blockSize, chunk.numSamples - offset);
+            state.cursor = state.voices.startTriggers (schedule, state.cursor, chunk.start + offset + offsetSamples,
+                                                       num, options.hitsoundGain);
+            state.voices.render (&chunk.buffer, offset, num, options.hitsoundGain);
+        }
+    }
+
+    // Written to a temporary file first; see OfflineRenderer::render()
+    std::unique_ptr<juce::AudioFormatWriter> createWriter (const juce::TemporaryFile& temp, OfflineRenderer::Format format,
+                                                           double sampleRate, juce::String& error)
+    {
+        std::unique_ptr<juce::AudioFormat> audioFormat;
+
+        if (format == OfflineRenderer::Format::Flac)
+            audioFormat = std::make_unique<juce::FlacAudioFormat>();
+        else
+            audioFormat = std::make_unique<juce::WavAudioFormat>();
+
+        auto stream = temp.getFile().createOutputStream();
+        if (stream == nullptr)
+        {
+            error = "Can't write to " + temp.getFile().getParentDirectory().getFullPathName();
+            return nullptr;
+        }
+
+        std::unique_ptr<juce::AudioFormatWriter> writer (audioFormat->createWriterFor (stream.get(), sampleRate, numOutputChannels,
+                                                                                       bitsPerSample, {}, 0));
+        if (writer == nullptr)
+        {
+            error = "Can't create a " + audioFormat->getFormatName() + " writer at this sample rate";
+            return nullptr;
+        }
+
+        stream.release();  // Now owned by the writer
+        return writer;
+    }
+
+    // The song or the last hitsound, whichever ends later. Zero if the song can't be read.
+    juce::int64 getRenderLength (const PlaybackSchedule& schedule, const OfflineRenderer::Options& options,
+                                 double sampleRate, juce::int64 offsetSamples)
+    {
+        juce::int64 length = 0;
+
+        if (options.content == OfflineRenderer::Content::FullMix)
+        {
+            juce::AudioFormatManager formatManager;
+            formatManager.registerBasicFormats();
+
+            std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (options.songFile));
+            if (reader == nullptr)
+                return 0;
+
+            length = (juce::int64) std::ceil ((double) reader->lengthInSamples * sampleRate / reader->sampleRate);
+        }
+
+        for (const auto& trigger : schedule.getTriggers())
+            length = juce::jmax (length, trigger.samplePosition - offsetSamples
+                                             + schedule.getSample (trigger.sample)->getNumSamples());
+
+        return length;
+    }
+
+    // One top-level track's hitsounds, written straight through on a single worker
+    struct Stem
+    {
+        PlaybackSchedule schedule;
+        juce::File file;
+        std::unique_ptr<juce::TemporaryFile> temp;
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+        bool writeFailed = false;  // e.g. disk full
+    };
+
+    // A failed write stops every stem through 'cancelled'
+    void renderStem (Stem& stem, const OfflineRenderer::Options& options, juce::int64 length, juce::int64 offsetSamples,
+                     std::atomic<juce::int64>& samplesWritten, std::atomic<bool>& cancelled)
+    {
+        VoicePool voices;
+        voices.setPolyphony (options.maxVoices);
+        size_t cursor = stem.schedule.findFirstTriggerAt (offsetSamples);
+
+        juce::AudioBuffer<float> block (numOutputChannels, blockSize);
+
+        for (juce::int64 position = 0; position < length && ! cancelled.load(); position += blockSize)
+        {
+            const int num = (int) juce::jmin ((juce::int64) blockSize, length - position);
+
+            block.clear();
+            cursor = voices.startTriggers (stem.schedule, cursor, position + offsetSamples, num, options.hitsoundGain);
+            voices.render (&block, 0, num, options.hitsoundGain);
+
+            if (! stem.writer->writeFromAudioSampleBuffer (block, 0, num))
+            {
+                stem.writeFailed = true;
+                cancelled.store (true);
+                break;
+            }
+
+            samplesWritten += num;
+        }
+
+        stem.writer.reset();
+    }
+}
+
+juce::Result OfflineRenderer::render (const Project& project, const SampleRegistry& registry,
+                                      const Options& options, const ProgressCallback& onProgress)
+{
+    const double sampleRate = registry.getSampleRate();
+    const auto schedule = PlaybackSchedule::compile (project, registry, sampleRate);
+    const auto offsetSamples = (juce::int64) std::llround (options.offsetSeconds * sampleRate);
+
+    const auto length = getRenderLength (schedule, options, sampleRate, offsetSamples);
+
+    if (length <= 0)
+        return juce::Result::fail (options.content == Content::FullMix ? "Can't read " + options.songFile.getFileName()
+                                                                         : juce::String ("Nothing to render"));
+
+    // Sequential pass: advance the voices without mixing and note where each chunk starts
+    const juce::int64 chunkLength = (juce::int64) blockSize * blocksPerChunk;
+    const int numChunks = (int) ((length + chunkLength - 1) / chunkLength);
+
+    std::vector<ChunkStart> starts ((size_t) numChunks);
+    std::vector<Chunk> chunks ((size_t) numChunks);
+
+    {
+        ChunkStart state;
+        state.voices.setPolyphony (options.maxVoices);
+        state.cursor = schedule.findFirstTriggerAt (offsetSamples);
+
+        for (juce::int64 position = 0; position < length; position += blockSize)
+        {
+            if (position % chunkLength == 0)
+            {
+                const auto index = (size_t) (position / chunkLength);
+                starts[index] = state;
+                chunks[index].start = position;
+                chunks[index].numSamples = (int) juce::jmin (chunkLength, length - position);
+            }
+
+            const int num = (int) juce::jmin ((juce::int64) blockSize, length - position);
+            state.cursor = state.voices.startTriggers (schedule, state.cursor, position + offsetSamples, num, options.hitsoundGain);
+            state.voices.render (nullptr, 0, num, options.hitsoundGain);
+        }
+    }
+
+    juce::TemporaryFile temp (options.outputFile);
+    juce::String error;
+    auto writer = createWriter (temp, options.format, sampleRate, error);
+
+    if (writer == nullptr)
+        return juce::Result::fail (error);
+
+    // Chunks are mixed on every core and written in order as they finish
+    std::atomic<bool> cancelled { false };
+    bool writeFailed = false;
+    juce::ThreadPool pool (juce::ThreadPoolOptions{}.withThreadName ("Offline render")
+                                                    .withNumberOfThreads (juce::SystemStats::getNumCpus()));
+
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        pool.addJob ([&, i]
+        {
+            if (! cancelled.load())
+                renderChunk (chunks[i], starts[i], schedule, options, sampleRate, offsetSamples);
+
+            chunks[i].done.signal();
+        });
+    }
+
+    for (auto& chunk : chunks)
+    {
+        chunk.done.wait();
+
+        if (! cancelled.load())
+        {
+            if (! writer->writeFromAudioSampleBuffer (chunk.buffer, 0, chunk.numSamples))
+            {
+                writeFailed = true;
+                cancelled.store (true);
+            }
+            else
+            {
+                const double progress = (double) (chunk.start + chunk.numSamples) / (double) length;
+
+                if (onProgress && ! onProgress (progress))
+                    cancelled.store (true);
+            }
+        }
+
+        chunk.buffer.setSize (0, 0);
+    }
+
+    writer.reset();
+
+    if (writeFailed)
+        return juce::Result::fail ("Can't write to " + options.outputFile.getFullPathName());
+
+    if (cancelled.load())
+        return juce::Result::fail ("Cancelled");
+
+    if (! temp.overwriteTargetFileWithTemporary())
+        return juce::Result::fail ("Can't write to " + options.outputFile.getFullPathName());
+
+    DBG("OfflineRenderer: Rendered " + options.outputFile.getFileName());
+    return juce::Result::ok();
+}
+
+juce::Result OfflineRenderer::renderStems (const Project& project, const SampleRegistry& registry,
+                                           const juce::File& directory, const Options& options,
+                                           const ProgressCallback& onProgress)
+{
+    const double sampleRate = registry.getSampleRate();
+    const auto offsetSamples = (juce::int64) std::llround (options.offsetSeconds * sampleRate);
+
+    // Every stem is as long as the whole mix, so they line up when imported together
+    const auto length = getRenderLength (PlaybackSchedule::compile (project, registry, sampleRate),
+                                         options, sampleRate, offsetSamples);
+
+    if (length <= 0)
+        return juce::Result::fail ("Nothing to render");
+
+    if (! directory.createDirectory().wasOk())
+        return juce::Result::fail ("Can't create " + directory.getFullPathName());
+
+    const auto extension = options.format == Format::Flac ? ".flac" : ".wav";
+    std::vector<std::unique_ptr<Stem>> stems;
+
+    for (size_t i = 0; i < project.tracks.size(); ++i)
+    {
+        auto stem = std::make_unique<Stem>();
+        stem->schedule = PlaybackSchedule::compileStem (project, i, registry, sampleRate);
+
+        // Muted, not soloed or empty: silent in the mix, so there's nothing to export
+        if (stem->schedule.isEmpty())
+            continue;
+
+        const auto name = juce::String ((int) i + 1).paddedLeft ('0', 2) + " " + juce::String (project.tracks[i].name);
+        stem->file = directory.getChildFile (juce::File::createLegalFileName (name) + extension);
+        stem->temp = std::make_unique<juce::TemporaryFile> (stem->file);
+
+        juce::String error;
+        stem->writer = createWriter (*stem->temp, options.format, sampleRate, error);
+
+        if (stem->writer == nullptr)
+            return juce::Result::fail (error);
+
+        stems.push_back (std::move (stem));
+    }
+
+    if (stems.empty())
+        return juce::Result::fail ("No audible tracks to export");
+
+    // All stems render at once; their schedules share the registry's sample buffers
+    std::atomic<bool> cancelled { false };
+    std::atomic<juce::int64> samplesWritten { 0 };
+    std::atomic<int> numFinished { 0 };
+    juce::WaitableEvent allFinished;
+
+    {
+        juce::ThreadPool pool (juce::ThreadPoolOptions{}.withThreadName ("Stem render")
+                                                        .withNumberOfThreads (juce::SystemStats::getNumCpus()));
+
+        for (auto& stem : stems)
+        {
+            pool.addJob ([&, s = stem.get()]
+            {
+                renderStem (*s, options, length, offsetSamples, samplesWritten, cancelled);
+
+                if (++numFinished == (int) stems.size())
+                    allFinished.signal();
+            });
+        }
+
+        const auto totalSamples = (double) length * (double) stems.size();
+
+        while (! allFinished.wait (50.0))
+        {
+            if (onProgress && ! cancelled.load() && ! onProgress ((double) samplesWritten.load() / totalSamples))
+                cancelled.store (true);
+        }
+    }
+
+    for (auto& stem : stems)
+        if (stem->writeFailed)
+            return juce::Result::fail ("Can't write to " + stem->file.getFullPathName());
+
+    if (cancelled.load())
+        return juce::Result::fail ("Cancelled");
+
+    for (auto& stem : stems)
+        if (! stem->temp->overwriteTargetFileWithTemporary())
+            return juce::Result::fail ("Can't write to " + stem->file.getFullPathName());
+
+    DBG("OfflineRenderer: Rendered " + juce::String ((int) stems.size()) + " stems to " + directory.getFullPathName());
+    return juce::Result::ok();
+}
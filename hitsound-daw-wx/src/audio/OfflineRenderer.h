@@ -0,0 +1,53 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "../model/Project.h"
+#include "SampleRegistry.h"
+#include "VoicePool.h"
+#include <functional>
+#include <vector>
+
+// Bounces the song and hitsounds to a file, faster than realtime.
+//
+// Hitsounds go through the same PlaybackSchedule and VoicePool as live
+// playback. A quick sequential pass that only advances the voices records the
+// pool at every chunk boundary; the chunks are then mixed in parallel, each
+// starting from its snapshot, so voices ring across boundaries exactly as they
+// would in one continuous render.
+class OfflineRenderer
+{
+public:
+    enum class Format { Wav, Flac };
+    enum class Content { FullMix, HitsoundsOnly };
+
+    struct Options
+    {
+        juce::File outputFile;
+        Format format = Format::Wav;
+        Content content = Content::FullMix;
+
+        juce::File songFile;
+        float songGain = 1.0f;
+        float hitsoundGain = 0.6f;
+        double offsetSeconds = 0.0;  // As in EventPlaybackSource::setOffset
+        int maxVoices = VoicePool::defaultPolyphony;
+    };
+
+    // Called on the thread that called render() with the fraction written so far.
+    // Returning false cancels the render and deletes the partial file.
+    using ProgressCallback = std::function<bool (double progress)>;
+
+    // Renders at the registry's sample rate, using whatever samples it holds right now.
+    // Blocks until the file is written.
+    static juce::Result render (const Project& project, const SampleRegistry& registry,
+                                const Options& options, const ProgressCallback& onProgress);
+
+    // One hitsound file per top-level track or grouping, named "<nn> <track name>",
+    // all rendered at once on a worker pool. Gains, mute and solo apply as in the
+    // mix; tracks that are silent in the mix are skipped. Options::outputFile,
+    // content and songFile are ignored.
+    static juce::Result renderStems (const Project& project, const SampleRegistry& registry,
+                                     const juce::File& directory, const Options& options,
+                                     const ProgressCallback& onProgress);
+};
@@ -0,0 +1,167 @@
+#include "PlaybackSchedule.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace
+{
+    struct ScheduleCompiler
+    {
+        const SampleRegistry& registry;
+        double sampleRate;
+        bool anySolo;
+        std::vector<Trigger>& triggers;
+        const std::vector<std::shared_ptr<const CachedSample>>& samples;
+
+        // Resolved once per track, so events only copy ids
+        SampleId resolve (SampleSet bank, SampleType type, const Track& source) const
+        {
+            auto id = registry.resolveSampleId (bank, type, source.sampleIndex, juce::String (source.customFilename));
+
+            // Custom samples that haven't been rendered yet play the built-in one until they have
+            if ((size_t) id >= samples.size() || samples[(size_t) id] == nullptr)
+                id = SampleRegistry::getDefaultSampleId (bank, type);
+
+            // Samples that haven't been rendered yet are left out; the schedule is
+            // recompiled once they have
+            return samples[(size_t) id] != nullptr ? id : invalidSampleId;
+        }
+
+        std::vector<SampleId> resolveTrackSamples (const Track& source) const
+        {
+            std::vector<SampleId> ids;
+
+            if (source.layers.empty())
+            {
+                ids.push_back (resolve (source.sampleSet, source.sampleType, source));
+            }
+            else
+            {
+                for (const auto& layer : source.layers)
+                    ids.push_back (resolve (layer.bank, layer.type, source));
+            }
+
+            ids.erase (std::remove (ids.begin(), ids.end(), invalidSampleId), ids.end());
+            return ids;
+        }
+
+        int64_t toSamples (int32_t timeMs) const
+        {
+            return (int64_t) (timeMs * sampleRate / 1000.0);
+        }
+
+        void addSamples (int64_t position, const std::vector<SampleId>& ids, float gain, int meterSlot)
+        {
+            for (auto id : ids)
+                triggers.push_back ({ position, id, gain, meterSlot });
+        }
+
+        // What each of a track's events triggers
+        struct Source
+        {
+            struct Layer
+            {
+                std::vector<SampleId> ids;
+                double gain;
+            };
+
+            std::vector<Layer> layers;
+            int meterSlot;
+            int order;  // Position in the track tree, so simultaneous triggers keep track order
+        };
+
+        std::unordered_map<const Track*, Source> sources;
+        std::vector<std::pair<const Source*, double>> slotSources;
+
+        void resolveTrack (const Track& track, int meterSlot)
+        {
+            if (track.mute || (anySolo && ! track.solo))
+                return;
+
+            Source source { {}, meterSlot, (int) sources.size() };
+
+            if (! track.isGrouping)
+            {
+                source.layers.push_back ({ resolveTrackSamples (track), track.gain });
+            }
+            else
+            {
+                // Grouping: trigger child samples on parent's events
+                for (const auto& child : track.children)
+                    source.layers.push_back ({ child.mute ? std::vector<SampleId>() : resolveTrackSamples (child), track.gain * child.gain });
+            }
+
+            sources.emplace (&track, std::move (source));
+
+            for (const auto& child : track.children)
+                resolveTrack (child, meterSlot);
+        }
+
+        void addSlot (int32_t timeMs, const std::vector<Project::EventRef>& refs)
+        {
+            slotSources.clear();
+
+            for (const auto& ref : refs)
+            {
+                auto it = sources.find (ref.track);
+                if (it != sources.end())
+                    slotSources.push_back ({ &it->second, ref.volume });
+            }
+
+            std::stable_sort (slotSources.begin(), slotSources.end(),
+                              [] (const auto& a, const auto& b) { return a.first->order < b.first->order; });
+
+            const auto position = toSamples (timeMs);
+
+            for (const auto& [source, volume] : slotSources)
+                for (const auto& layer : source->layers)
+                    addSamples (position, layer.ids, (float) (layer.gain * volume), source->meterSlot);
+        }
+    };
+
+    bool hasSoloTrack (const std::vector<Track>& tracks)
+    {
+        for (const auto& t : tracks)
+        {
+            if (t.solo || hasSoloTrack (t.children))
+                return true;
+        }
+        return false;
+    }
+}
+
+PlaybackSchedule PlaybackSchedule::compile (const Project& project, const SampleRegistry& registry, double sampleRate)
+{
+    return compile (project, 0, project.tracks.size(), registry, sampleRate);
+}
+
+PlaybackSchedule PlaybackSchedule::compileStem (const Project& project, size_t trackIndex,
+                                                const SampleRegistry& registry, double sampleRate)
+{
+    jassert (trackIndex < project.tracks.size());
+    return compile (project, trackIndex, trackIndex + 1, registry, sampleRate);
+}
+
+PlaybackSchedule PlaybackSchedule::compile (const Project& project, size_t firstTrack, size_t endTrack,
+                                            const SampleRegistry& registry, double sampleRate)
+{
+    PlaybackSchedule schedule;
+    schedule.samples = registry.getSampleTable();
+
+    ScheduleCompiler compiler { registry, sampleRate, hasSoloTrack (project.tracks), schedule.triggers, schedule.samples };
+
+    for (size_t i = firstTrack; i < endTrack; ++i)
+        compiler.resolveTrack (project.tracks[i], (int) i);
+
+    // The project's time index is in time order, so the triggers come out sorted
+    for (const auto& [timeMs, refs] : project.GetTimeIndex())
+        compiler.addSlot (timeMs, refs);
+
+    return schedule;
+}
+
+size_t PlaybackSchedule::findFirstTriggerAt (int64_t samplePosition) const
+{
+    auto it = std::lower_bound (triggers.begin(), triggers.end(), samplePosition,
+                                [] (const Trigger& t, int64_t pos) { return t.samplePosition < pos; });
+    return (size_t) std::distance (triggers.begin(), it);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "../model/Project.h"
+#include "SampleRegistry.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// A single sample start, fully resolved on the UI thread.
+struct Trigger
+{
+    int64_t samplePosition;  // Song position in device samples
+    SampleId sample;         // Index into the schedule's sample table
+    float gain;              // Track, child and event gain combined
+    int meterSlot;           // Index of the top-level track it belongs to, for LevelMeters
+};
+
+// Flat, time-sorted list of every sample the project will play. Grouping,
+// layers, mute and solo are resolved at compile time, so the audio thread
+// only has to walk a cursor forward through the triggers.
+// The schedule holds the registry's sample table as of compile time, so buffers
+// the registry has since replaced stay valid for as long as the schedule does.
+class PlaybackSchedule
+{
+public:
+    static PlaybackSchedule compile (const Project& project, const SampleRegistry& registry, double sampleRate);
+
+    // Only the triggers of project.tracks[trackIndex] and its children. Mute and solo are
+    // still judged against the whole project, so a stem sounds as it does in the mix.
+    static PlaybackSchedule compileStem (const Project& project, size_t trackIndex,
+                                         const SampleRegistry& registry, double sampleRate);
+
+    // Index of the first trigger at or after the given position (binary search)
+    size_t findFirstTriggerAt (int64_t samplePosition) const;
+
+    const std::vector<Trigger>& getTriggers() const { return triggers; }
+
+    // Never null for an id taken from one of this schedule's triggers
+    const CachedSample* getSample (SampleId id) const { return samples[(size_t) id].get(); }
+    bool isEmpty() const { return triggers.empty(); }
+
+private:
+    static PlaybackSchedule compile (const Project& project, size_t firstTrack, size_t endTrack,
+                                     const SampleRegistry& registry, double sampleRate);
+
+    std::vector<Trigger> triggers;
+    std::vector<std::shared_ptr<const CachedSample>> samples;
+};
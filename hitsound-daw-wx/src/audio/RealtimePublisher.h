@@ -0,0 +1,81 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <memory>
+
+// Hands immutable objects from a single non-realtime writer to the audio thread
+// without locks (read-copy-update).
+//
+// The writer builds a complete object and publish()es it with one atomic swap.
+// The audio thread picks up the newest object with takeLatest() at the start of
+// a block and owns it from then on. Once it no longer needs an object it hands
+// it back with retire(); retired objects travel through a wait-free FIFO and
+// are deleted by the writer in collectGarbage(), so the audio thread never
+// blocks and never frees memory.
+template <typename T>
+class RealtimePublisher
+{
+public:
+    RealtimePublisher() = default;
+
+    // The audio thread must have stopped. Objects it still owns are its own to delete.
+    ~RealtimePublisher()
+    {
+        delete pending.exchange (nullptr, std::memory_order_acq_rel);
+        collectGarbage();
+    }
+
+    // Writer thread
+    void publish (std::unique_ptr<T> object)
+    {
+        collectGarbage();
+
+        // An object still pending was never seen by the audio thread, so it can go straight away
+        delete pending.exchange (object.release(), std::memory_order_acq_rel);
+    }
+
+    // Writer thread: frees everything the audio thread has retired so far
+    void collectGarbage()
+    {
+        int start1, size1, start2, size2;
+        retiredFifo.prepareToRead (retiredFifo.getNumReady(), start1, size1, start2, size2);
+
+        for (int i = 0; i < size1; ++i) delete retiredSlots[(size_t) (start1 + i)];
+        for (int i = 0; i < size2; ++i) delete retiredSlots[(size_t) (start2 + i)];
+
+        retiredFifo.finishedRead (size1 + size2);
+    }
+
+    // Audio thread: returns the object published since the last call, or nullptr
+    T* takeLatest() noexcept
+    {
+        return pending.exchange (nullptr, std::memory_order_acq_rel);
+    }
+
+    // Audio thread: queues an object for deletion on the writer thread.
+    // Returns false if the queue is full; the caller keeps it and tries again later.
+    bool retire (T* object) noexcept
+    {
+        int start1, size1, start2, size2;
+        retiredFifo.prepareToWrite (1, start1, size1, start2, size2);
+
+        if (size1 == 0)
+            return false;
+
+        retiredSlots[(size_t) start1] = object;
+        retiredFifo.finishedWrite (1);
+        return true;
+    }
+
+private:
+    static constexpr int retiredCapacity = 16;
+
+    std::atomic<T*> pending { nullptr };
+
+    juce::AbstractFifo retiredFifo { retiredCapacity };
+    std::array<T*, retiredCapacity> retiredSlots {};
+
+    JUCE_DECLARE_NON_COPYABLE (RealtimePublisher)
+};
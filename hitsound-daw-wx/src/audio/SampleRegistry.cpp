@@ -1,53 +1,630 @@
 #include "SampleRegistry.h"
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+
+namespace
+{
+    // Resamples one channel and drops the interpolator's algorithmic delay,
+    // so the hitsound's onset stays where it was in the file.
+    template <typename Interpolator>
+    void resampleChannel (const float* input, float* output, int numOutput, double ratio)
+    {
+        const int latency = (int) std::round (Interpolator::getBaseLatency() / ratio);
+
+        Interpolator interpolator;
+        if (latency > 0)
+        {
+            std::vector<float> skipped ((size_t) latency);
+            input += interpolator.process (ratio, input, skipped.data(), latency);
+        }
+
+        interpolator.process (ratio, input, output, numOutput);
+    }
+
+    // Custom indices past this are ignored rather than growing the index table
+    constexpr int maxCustomIndex = 1000;
+
+    const char* const setNames[] = { "normal", "soft", "drum" };
+    const char* const typeNames[] = { "hitnormal", "hitwhistle", "hitfinish", "hitclap",
+                                      "sliderslide", "slidertick", "sliderwhistle" };
+
+    // Parses osu! sample names like "soft-hitclap2": set, type, then an optional
+    // index (none means 1). Matches SampleSet/SampleType order.
+    bool parseSampleFilename (const juce::String& name, SampleSet& set, SampleType& type, int& index)
+    {
+        const auto lower = name.toLowerCase();
+
+        for (int s = 0; s < (int) std::size (setNames); ++s)
+        {
+            for (int t = 0; t < (int) std::size (typeNames); ++t)
+            {
+                const auto prefix = juce::String (setNames[s]) + "-" + typeNames[t];
+                if (! lower.startsWith (prefix))
+                    continue;
+
+                const auto suffix = lower.substring (prefix.length());
+                if (suffix.isEmpty())
+                    index = 1;
+                else if (suffix.containsOnly ("0123456789") && suffix.length() <= 4)
+                    index = suffix.getIntValue();
+                else
+                    continue;
+
+                // osu! looks up index 1 without a number, so "normal-hitclap1.wav" is never used
+                if (index < 2 && suffix.isNotEmpty())
+                    return false;
+
+                set = static_cast<SampleSet> (s);
+                type = static_cast<SampleType> (t);
+                return index <= maxCustomIndex;
+            }
+        }
+
+        return false;
+    }
+
+    size_t getBufferBytes (const juce::AudioBuffer<float>& buffer)
+    {
+        return sizeof (float) * (size_t) buffer.getNumChannels() * (size_t) buffer.getNumSamples();
+    }
+}
+
+void CachedSample::computeLevels()
+{
+    const int numSamples = getNumSamples();
+    const int numChannels = getNumChannels();
+    const int numWindows = (numSamples + meterWindow - 1) / meterWindow;
+
+    windowPeaks.assign ((size_t) numWindows, 0.0f);
+    windowMeanSquares.assign ((size_t) numWindows, 0.0f);
+
+    if (numChannels == 0)
+        return;
+
+    for (int w = 0; w < numWindows; ++w)
+    {
+        const int start = w * meterWindow;
+        const int length = juce::jmin (meterWindow, numSamples - start);
+        float peak = 0.0f;
+        float sum = 0.0f;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const auto range = juce::FloatVectorOperations::findMinAndMax (buffer.getReadPointer (ch, start), length);
+            peak = juce::jmax (peak, -range.getStart(), range.getEnd());
+
+            const auto rms = buffer.getRMSLevel (ch, start, length);
+            sum += rms * rms;
+        }
+
+        windowPeaks[(size_t) w] = peak;
+        windowMeanSquares[(size_t) w] = sum / (float) numChannels;
+    }
+}
+
+void CachedSample::getLevel (int start, int numSamples, float& peak, float& sumOfSquares) const noexcept
+{
+    peak = 0.0f;
+    sumOfSquares = 0.0f;
+
+    if (numSamples <= 0 || windowPeaks.empty())
+        return;
+
+    const int first = start / meterWindow;
+    const int last = juce::jmin ((int) windowPeaks.size() - 1, (start + numSamples - 1) / meterWindow);
+    float meanSquares = 0.0f;
+
+    for (int w = first; w <= last; ++w)
+    {
+        peak = juce::jmax (peak, windowPeaks[(size_t) w]);
+        meanSquares += windowMeanSquares[(size_t) w];
+    }
+
+    // Each window's mean stands in for the part of it that was played
+    sumOfSquares = meanSquares * (float) numSamples / (float) (last - first + 1);
+}
 
 SampleRegistry::SampleRegistry()
+    : entries ((size_t) numDefaultSamples)
 {
     formatManager.registerBasicFormats();
+
+    skinIds.fill (invalidSampleId);
+    rebuildResolvedIds();
 }
 
-juce::String SampleRegistry::makeKey (const SampleRef& ref)
+SampleRegistry::~SampleRegistry()
 {
-    return juce::String (static_cast<int> (ref.set)) + "-" + juce::String (static_cast<int> (ref.type)) + "-" + ref.file.getFullPathName();
+    loadPool.removeAllJobs (true, -1);
+    ++renderGeneration;
+    renderPool.removeAllJobs (true, -1);
 }
 
-void SampleRegistry::addSample (const SampleRef& ref)
+bool SampleRegistry::decodeFile (const juce::File& file, SampleEntry& entry)
 {
-    auto key = makeKey (ref);
-    if (samples.find (key) != samples.end())
-        return;
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (file));
+    if (reader == nullptr || reader->lengthInSamples <= 0)
+        return false;
+
+    // Hitsounds are mixed as mono or stereo; anything wider is folded to the first two channels.
+    const int numChannels = (int) juce::jlimit (1u, 2u, reader->numChannels);
+    const int length = (int) reader->lengthInSamples;
+
+    auto source = std::make_shared<juce::AudioBuffer<float>> (numChannels, length);
+    if (! reader->read (source.get(), 0, length, 0, true, true))
+        return false;
 
-    if (! ref.file.existsAsFile())
+    entry.file = file;
+    entry.source = std::move (source);
+    entry.sourceSampleRate = reader->sampleRate;
+    return true;
+}
+
+std::shared_ptr<const CachedSample> SampleRegistry::render (const juce::AudioBuffer<float>& source, double sourceRate,
+                                                           double targetRate, ResampleQuality targetQuality)
+{
+    auto sample = std::make_shared<CachedSample>();
+    sample->sampleRate = targetRate;
+
+    if (sourceRate <= 0.0 || sourceRate == targetRate)
     {
-        DBG("SampleRegistry: Sample file not found: " + ref.file.getFullPathName());
-        return;
+        sample->buffer.makeCopyOf (source);
+        sample->computeLevels();
+        return sample;
+    }
+
+    const int numChannels = source.getNumChannels();
+    const int sourceLength = source.getNumSamples();
+    const double ratio = sourceRate / targetRate;
+    const int destLength = (int) std::ceil (sourceLength / ratio);
+
+    // The interpolators read ahead of their output, so pad the input with silence
+    const int padding = 2 * (int) std::ceil (juce::WindowedSincInterpolator::getBaseLatency()) + 8;
+    juce::AudioBuffer<float> padded (numChannels, sourceLength + padding);
+    padded.clear();
+    for (int ch = 0; ch < numChannels; ++ch)
+        padded.copyFrom (ch, 0, source, ch, 0, sourceLength);
+
+    sample->buffer.setSize (numChannels, destLength, false, false, false);
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        if (targetQuality == ResampleQuality::WindowedSinc)
+            resampleChannel<juce::WindowedSincInterpolator> (padded.getReadPointer (ch), sample->buffer.getWritePointer (ch), destLength, ratio);
+        else
+            resampleChannel<juce::LinearInterpolator> (padded.getReadPointer (ch), sample->buffer.getWritePointer (ch), destLength, ratio);
+    }
+
+    sample->computeLevels();
+    return sample;
+}
+
+void SampleRegistry::startRendering (bool notifyAlways)
+{
+    int generation;
+    double targetRate;
+    ResampleQuality targetQuality;
+
+    {
+        const juce::ScopedLock sl (lock);
+        generation = renderGeneration.load();
+        targetRate = sampleRate;
+        targetQuality = quality;
+    }
+
+    renderPool.addJob ([this, generation, targetRate, targetQuality, notifyAlways]
+    {
+        renderPending (generation, targetRate, targetQuality, notifyAlways);
+    });
+}
+
+void SampleRegistry::renderPending (int generation, double targetRate, ResampleQuality targetQuality, bool notifyAlways)
+{
+    struct Job
+    {
+        SampleId id;
+        std::shared_ptr<const juce::AudioBuffer<float>> source;
+        double sourceSampleRate;
+    };
+
+    std::vector<Job> jobs;
+
+    {
+        const juce::ScopedLock sl (lock);
+
+        for (size_t id = 0; id < entries.size(); ++id)
+        {
+            const auto& entry = entries[id];
+            if (entry.source != nullptr && entry.renderedGeneration != generation)
+                jobs.push_back ({ (SampleId) id, entry.source, entry.sourceSampleRate });
+        }
     }
 
-    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (ref.file));
-    if (reader != nullptr)
+    int numInstalled = 0;
+
+    // Ids that share a source (identical files) share its rendered buffer too
+    std::map<const juce::AudioBuffer<float>*, std::shared_ptr<const CachedSample>> renderedSources;
+
+    for (const auto& job : jobs)
+    {
+        if (renderGeneration.load() != generation)
+            return;  // The rate or quality changed; a newer job will redo this
+
+        auto& rendered = renderedSources[job.source.get()];
+        if (rendered == nullptr)
+            rendered = render (*job.source, job.sourceSampleRate, targetRate, targetQuality);
+
+        const juce::ScopedLock sl (lock);
+        auto& entry = entries[(size_t) job.id];
+
+        // Skip entries that were reloaded from a different file meanwhile
+        if (renderGeneration.load() != generation || entry.source != job.source)
+            continue;
+
+        entry.sample = rendered;
+        entry.renderedGeneration = generation;
+        ++numInstalled;
+    }
+
+    {
+        const juce::ScopedLock sl (lock);
+        enforceMemoryBudget();
+    }
+
+    if (numInstalled > 0)
+        DBG("SampleRegistry: Rendered " + juce::String (numInstalled) + " samples at " + juce::String (targetRate) + " Hz");
+
+    if ((numInstalled > 0 || notifyAlways) && onSamplesRendered)
+        onSamplesRendered();
+}
+
+void SampleRegistry::setSampleRate (double newSampleRate)
+{
+    {
+        const juce::ScopedLock sl (lock);
+        if (newSampleRate <= 0.0 || newSampleRate == sampleRate)
+            return;
+
+        sampleRate = newSampleRate;
+        ++renderGeneration;
+    }
+
+    // Schedules are compiled in device samples, so a new rate always needs a recompile
+    startRendering (true);
+}
+
+double SampleRegistry::getSampleRate() const
+{
+    const juce::ScopedLock sl (lock);
+    return sampleRate;
+}
+
+bool SampleRegistry::waitUntilIdle (int timeoutMs) const
+{
+    const auto start = juce::Time::getMillisecondCounter();
+
+    // Load jobs queue their render before they finish, so checking loads first can't miss one
+    while (pendingLoads.load() > 0 || loadPool.getNumJobs() > 0 || renderPool.getNumJobs() > 0)
+    {
+        if (timeoutMs >= 0 && juce::Time::getMillisecondCounter() - start >= (juce::uint32) timeoutMs)
+            return false;
+
+        juce::Thread::sleep (10);
+    }
+
+    return true;
+}
+
+void SampleRegistry::setResampleQuality (ResampleQuality newQuality)
+{
+    {
+        const juce::ScopedLock sl (lock);
+        if (newQuality == quality)
+            return;
+
+        quality = newQuality;
+        ++renderGeneration;
+    }
+
+    startRendering();
+}
+
+ResampleQuality SampleRegistry::getResampleQuality() const
+{
+    const juce::ScopedLock sl (lock);
+    return quality;
+}
+
+int SampleRegistry::getDefaultSampleCount() const
+{
+    const juce::ScopedLock sl (lock);
+
+    int count = 0;
+    for (int id = 0; id < numDefaultSamples; ++id)
+        if (entries[(size_t) id].source != nullptr)
+            ++count;
+
+    return count;
+}
+
+SampleId SampleRegistry::addSample (const SampleRef& ref)
+{
+    const auto id = internFile (ref.file);
+    if (id != invalidSampleId)
+        startRendering();
+
+    return id;
+}
+
+SampleId SampleRegistry::internFile (const juce::File& file)
+{
+    const auto path = file.getFullPathName();
+
     {
-        samples[key] = { ref, std::move (reader) };
-        DBG("SampleRegistry: Loaded sample: " + ref.file.getFileName());
+        const juce::ScopedLock sl (lock);
+        auto it = customIds.find (path);
+        if (it != customIds.end() && entries[(size_t) it->second].source != nullptr)
+        {
+            ++stats.hits;
+            touch (it->second);
+            return it->second;
+        }
+    }
+
+    if (! file.existsAsFile())
+    {
+        DBG("SampleRegistry: Sample file not found: " + path);
+        return invalidSampleId;
+    }
+
+    // Map sets often ship byte-identical copies of the same sample; those share one buffer
+    const auto hash = juce::MD5 (file).toHexString();
+
+    {
+        const juce::ScopedLock sl (lock);
+        const auto sharedId = findByContent (hash);
+        if (sharedId != invalidSampleId)
+        {
+            SampleEntry entry = entries[(size_t) sharedId];
+            entry.file = file;
+
+            ++stats.hits;
+            return assignCustomId (path, std::move (entry));
+        }
+    }
+
+    SampleEntry entry;
+    if (! decodeFile (file, entry))
+    {
+        DBG("SampleRegistry: Failed to decode sample: " + file.getFileName());
+        return invalidSampleId;
+    }
+
+    entry.contentHash = hash;
+
+    SampleId id;
+
+    {
+        const juce::ScopedLock sl (lock);
+
+        // Another thread may have added the same file while this one was decoding
+        auto it = customIds.find (path);
+        if (it != customIds.end() && entries[(size_t) it->second].source != nullptr)
+            return it->second;
+
+        ++stats.misses;
+        id = assignCustomId (path, std::move (entry));
+        idsByHash[hash] = id;
+    }
+
+    DBG("SampleRegistry: Loaded sample: " + file.getFileName());
+    return id;
+}
+
+SampleId SampleRegistry::assignCustomId (const juce::String& path, SampleEntry entry)
+{
+    // An evicted file gets its old id back
+    auto it = customIds.find (path);
+    const SampleId id = it != customIds.end() ? it->second : (SampleId) entries.size();
+
+    if (it == customIds.end())
+    {
+        entries.push_back (std::move (entry));
+        customIds[path] = id;
     }
     else
     {
-        DBG("SampleRegistry: Failed to create reader for: " + ref.file.getFileName());
+        entries[(size_t) id] = std::move (entry);
+    }
+
+    touch (id);
+    return id;
+}
+
+SampleId SampleRegistry::findByContent (const juce::String& hash)
+{
+    auto it = idsByHash.find (hash);
+    if (it == idsByHash.end())
+        return invalidSampleId;
+
+    if (entries[(size_t) it->second].source != nullptr)
+        return it->second;
+
+    // That one was evicted; another id may still hold the same audio
+    for (size_t id = numDefaultSamples; id < entries.size(); ++id)
+    {
+        if (entries[id].source != nullptr && entries[id].contentHash == hash)
+        {
+            it->second = (SampleId) id;
+            return it->second;
+        }
+    }
+
+    idsByHash.erase (it);
+    return invalidSampleId;
+}
+
+size_t SampleRegistry::computeMemoryUsed (int* numShared) const
+{
+    std::set<const void*> counted;
+    size_t bytes = 0;
+
+    auto count = [&] (const void* key, const juce::AudioBuffer<float>& buffer)
+    {
+        if (! counted.insert (key).second)
+            return false;
+
+        bytes += getBufferBytes (buffer);
+        return true;
+    };
+
+    if (numShared != nullptr)
+        *numShared = 0;
+
+    for (const auto& entry : entries)
+    {
+        if (entry.source == nullptr)
+            continue;
+
+        if (! count (entry.source.get(), *entry.source) && numShared != nullptr)
+            ++*numShared;
+
+        if (entry.sample != nullptr)
+            count (entry.sample.get(), entry.sample->buffer);
+    }
+
+    return bytes;
+}
+
+void SampleRegistry::enforceMemoryBudget()
+{
+    // Identical files share buffers, so a buffer's memory only comes back once
+    // its last holder is evicted. The holders are counted in one pass up front
+    // and the evictions below just update the counts.
+    struct Holders { int count = 0; size_t bytes = 0; };
+    std::unordered_map<const void*, Holders> holders;
+    size_t used = 0;
+
+    auto hold = [&] (const void* key, const juce::AudioBuffer<float>& buffer)
+    {
+        auto& h = holders[key];
+        if (h.count++ == 0)
+        {
+            h.bytes = getBufferBytes (buffer);
+            used += h.bytes;
+        }
+    };
+
+    auto release = [&] (const void* key)
+    {
+        auto& h = holders[key];
+        if (--h.count == 0)
+            used -= h.bytes;
+    };
+
+    for (const auto& entry : entries)
+    {
+        if (entry.source == nullptr)
+            continue;
+
+        hold (entry.source.get(), *entry.source);
+        if (entry.sample != nullptr)
+            hold (entry.sample.get(), entry.sample->buffer);
+    }
+
+    if (used <= memoryBudget)
+        return;
+
+    std::set<SampleId> inUse (beatmapIds.begin(), beatmapIds.end());
+    inUse.insert (beatmapNamedIds.begin(), beatmapNamedIds.end());
+    inUse.insert (skinIds.begin(), skinIds.end());
+
+    std::vector<SampleId> candidates;
+    for (SampleId id = numDefaultSamples; id < (SampleId) entries.size(); ++id)
+        if (entries[(size_t) id].source != nullptr && inUse.count (id) == 0)
+            candidates.push_back (id);
+
+    std::sort (candidates.begin(), candidates.end(), [this] (SampleId a, SampleId b)
+    {
+        return entries[(size_t) a].lastUsed < entries[(size_t) b].lastUsed;
+    });
+
+    int numEvicted = 0;
+
+    for (auto id : candidates)
+    {
+        if (used <= memoryBudget)
+            break;
+
+        // Schedules keep their own references, so anything still playing stays alive
+        auto& entry = entries[(size_t) id];
+        release (entry.source.get());
+        if (entry.sample != nullptr)
+            release (entry.sample.get());
+
+        entry.source = nullptr;
+        entry.sample = nullptr;
+        entry.renderedGeneration = -1;
+
+        ++numEvicted;
     }
+
+    stats.numEvicted += numEvicted;
+
+    if (numEvicted > 0)
+        DBG("SampleRegistry: Evicted " + juce::String (numEvicted) + " samples, " + juce::String ((juce::int64) (used / 1024)) + " KB in use");
+}
+
+void SampleRegistry::setMemoryBudget (size_t bytes)
+{
+    const juce::ScopedLock sl (lock);
+    memoryBudget = bytes;
+    enforceMemoryBudget();
 }
 
-juce::AudioFormatReader* SampleRegistry::getReader (const SampleRef& ref)
+SampleCacheStats SampleRegistry::getCacheStats() const
 {
-    auto key = makeKey (ref);
-    auto it = samples.find (key);
-    if (it != samples.end())
-        return it->second.reader.get();
+    const juce::ScopedLock sl (lock);
+
+    SampleCacheStats result = stats;
+    result.memoryBudget = memoryBudget;
+    result.memoryUsed = computeMemoryUsed (&result.numShared);
+
+    for (const auto& entry : entries)
+        if (entry.source != nullptr)
+            ++result.numSamples;
 
-    // Fall back to default samples
-    juce::String defaultKey = juce::String (static_cast<int> (ref.set)) + "-" + juce::String (static_cast<int> (ref.type));
-    auto defaultIt = defaultSamples.find (defaultKey);
-    if (defaultIt != defaultSamples.end())
-        return defaultIt->second.get();
+    return result;
+}
 
-    return nullptr;
+SampleId SampleRegistry::findSampleId (const juce::File& file) const
+{
+    const juce::ScopedLock sl (lock);
+    auto it = customIds.find (file.getFullPathName());
+    return it != customIds.end() ? it->second : invalidSampleId;
+}
+
+std::shared_ptr<const CachedSample> SampleRegistry::getSample (SampleId id) const
+{
+    const juce::ScopedLock sl (lock);
+
+    if (id < 0 || id >= (SampleId) entries.size())
+        return nullptr;
+
+    return entries[(size_t) id].sample;
+}
+
+std::vector<std::shared_ptr<const CachedSample>> SampleRegistry::getSampleTable() const
+{
+    const juce::ScopedLock sl (lock);
+
+    std::vector<std::shared_ptr<const CachedSample>> table;
+    table.reserve (entries.size());
+
+    for (const auto& entry : entries)
+        table.push_back (entry.sample);
+
+    return table;
 }
 
 void SampleRegistry::loadDefaultSamples (const juce::File& dir)
@@ -76,11 +653,12 @@ void SampleRegistry::loadDefaultSamples (const juce::File& dir)
         auto file = dir.getChildFile (def.filename);
         if (file.existsAsFile())
         {
-            std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (file));
-            if (reader != nullptr)
+            SampleEntry entry;
+
+            if (decodeFile (file, entry))
             {
-                juce::String key = juce::String (static_cast<int> (def.set)) + "-" + juce::String (static_cast<int> (def.type));
-                defaultSamples[key] = std::move (reader);
+                const juce::ScopedLock sl (lock);
+                entries[(size_t) getDefaultSampleId (def.set, def.type)] = std::move (entry);
                 DBG("SampleRegistry: Loaded default sample: " + def.filename);
             }
             else
@@ -93,4 +671,261 @@ void SampleRegistry::loadDefaultSamples (const juce::File& dir)
             DBG("SampleRegistry: Default sample not found: " + def.filename);
         }
     }
+
+    startRendering();
+}
+
+void SampleRegistry::loadBeatmapSamples (const juce::File& beatmapDir, const juce::StringArray& namedFiles)
+{
+    int batch;
+
+    {
+        // Anything still loading for the previous beatmap is abandoned. Jobs that
+        // are already running finish in the background rather than being waited
+        // for; the generation checks keep their results out of the new tables.
+        const juce::ScopedLock sl (lock);
+        batch = ++loadBatch;
+        pendingLoads = 0;
+    }
+
+    loadPool.removeAllJobs (true, 0);
+
+    {
+        // A skin scan that was cancelled above has to be queued again
+        const juce::ScopedLock sl (lock);
+        if (! skinScanned)
+            skinRequested = false;
+    }
+
+    // Index table slot -> file, preferring .wav when a name exists with several extensions
+    std::map<int, juce::File> indexedFiles;
+    int maxIndex = 0;
+
+    if (beatmapDir.isDirectory())
+    {
+        for (const auto& file : beatmapDir.findChildFiles (juce::File::findFiles, false))
+        {
+            SampleSet set;
+            SampleType type;
+            int index;
+
+            if (! file.hasFileExtension ("wav;ogg;mp3") || ! parseSampleFilename (file.getFileNameWithoutExtension(), set, type, index))
+                continue;
+
+            const int slot = (index - 1) * numDefaultSamples + getDefaultSampleId (set, type);
+            auto it = indexedFiles.find (slot);
+            if (it == indexedFiles.end() || (file.hasFileExtension ("wav") && ! it->second.hasFileExtension ("wav")))
+                indexedFiles[slot] = file;
+
+            maxIndex = juce::jmax (maxIndex, index);
+        }
+    }
+
+    struct Load { juce::File file; int slot; };
+    std::vector<Load> loads;
+
+    for (const auto& [slot, file] : indexedFiles)
+        loads.push_back ({ file, slot });
+
+    for (const auto& name : namedFiles)
+    {
+        auto file = beatmapDir.getChildFile (name);
+        if (file.existsAsFile())
+            loads.push_back ({ file, -1 });
+    }
+
+    int generation;
+
+    {
+        const juce::ScopedLock sl (lock);
+        beatmapDirectory = beatmapDir;
+        beatmapIds.assign ((size_t) (maxIndex * numDefaultSamples), invalidSampleId);
+        beatmapNamedIds.clear();
+        generation = ++beatmapGeneration;
+        rebuildResolvedIds();
+    }
+
+    loadSkinSamples();
+
+    DBG("SampleRegistry: Loading " + juce::String ((int) loads.size()) + " beatmap samples from " + beatmapDir.getFullPathName());
+
+    pendingLoads += (int) loads.size();
+
+    // Nothing to load: the tables still changed, so the schedule has to be compiled against them
+    if (pendingLoads.load() == 0)
+        startRendering (true);
+
+    for (const auto& load : loads)
+    {
+        loadPool.addJob ([this, load, generation, batch]
+        {
+            const auto id = internFile (load.file);
+
+            if (id != invalidSampleId)
+            {
+                const juce::ScopedLock sl (lock);
+                if (beatmapGeneration == generation)
+                {
+                    if (load.slot < 0)
+                    {
+                        beatmapNamedIds.push_back (id);
+                    }
+                    else
+                    {
+                        beatmapIds[(size_t) load.slot] = id;
+                        rebuildResolvedIds();
+                    }
+                }
+            }
+
+            finishLoad (batch);
+        });
+    }
+}
+
+void SampleRegistry::finishLoad (int batch)
+{
+    {
+        const juce::ScopedLock sl (lock);
+        if (batch != loadBatch || --pendingLoads != 0)
+            return;
+    }
+
+    // Render once the whole batch is in, rather than once per file
+    startRendering (true);
+}
+
+void SampleRegistry::setSkinDirectory (const juce::File& dir)
+{
+    bool beatmapLoaded;
+
+    {
+        const juce::ScopedLock sl (lock);
+        if (dir == skinDirectory)
+            return;
+
+        skinDirectory = dir;
+        skinIds.fill (invalidSampleId);
+        skinRequested = false;
+        skinScanned = false;
+        ++skinGeneration;
+        rebuildResolvedIds();
+
+        beatmapLoaded = beatmapDirectory != juce::File();
+    }
+
+    // Otherwise the scan waits for the first beatmap
+    if (beatmapLoaded)
+        loadSkinSamples();
+}
+
+juce::File SampleRegistry::getSkinDirectory() const
+{
+    const juce::ScopedLock sl (lock);
+    return skinDirectory;
+}
+
+void SampleRegistry::loadSkinSamples()
+{
+    juce::File dir;
+    int generation, batch;
+
+    {
+        const juce::ScopedLock sl (lock);
+        if (skinRequested || ! skinDirectory.isDirectory())
+            return;
+
+        skinRequested = true;
+        dir = skinDirectory;
+        generation = skinGeneration;
+        batch = loadBatch;
+        ++pendingLoads;
+    }
+
+    loadPool.addJob ([this, dir, generation, batch]
+    {
+        // Skins hold hundreds of files; list the folder once and look the hitsounds up by name
+        std::map<juce::String, juce::File> filesByName;
+        for (const auto& file : dir.findChildFiles (juce::File::findFiles, false))
+            filesByName[file.getFileName().toLowerCase()] = file;
+
+        std::array<SampleId, numDefaultSamples> ids;
+        ids.fill (invalidSampleId);
+        int numFound = 0;
+
+        for (int s = 0; s < numSampleSets; ++s)
+        {
+            for (int t = 0; t < numSampleTypes; ++t)
+            {
+                const auto name = juce::String (setNames[s]) + "-" + typeNames[t];
+
+                for (const char* extension : { ".wav", ".ogg", ".mp3" })
+                {
+                    auto it = filesByName.find (name + extension);
+                    if (it == filesByName.end())
+                        continue;
+
+                    const auto id = internFile (it->second);
+                    if (id != invalidSampleId)
+                    {
+                        ids[(size_t) getDefaultSampleId (static_cast<SampleSet> (s), static_cast<SampleType> (t))] = id;
+                        ++numFound;
+                        break;
+                    }
+                }
+            }
+        }
+
+        {
+            const juce::ScopedLock sl (lock);
+            if (skinGeneration == generation)
+            {
+                skinIds = ids;
+                skinScanned = true;
+                rebuildResolvedIds();
+            }
+        }
+
+        DBG("SampleRegistry: Found " + juce::String (numFound) + " skin samples in " + dir.getFullPathName());
+        finishLoad (batch);
+    });
+}
+
+void SampleRegistry::rebuildResolvedIds()
+{
+    const size_t numRows = beatmapIds.size() / numDefaultSamples + 1;
+    resolvedIds.resize (numRows * numDefaultSamples);
+
+    for (SampleId id = 0; id < numDefaultSamples; ++id)
+        resolvedIds[(size_t) id] = skinIds[(size_t) id] != invalidSampleId ? skinIds[(size_t) id] : id;
+
+    for (size_t i = numDefaultSamples; i < resolvedIds.size(); ++i)
+    {
+        const auto beatmapId = beatmapIds[i - numDefaultSamples];
+        resolvedIds[i] = beatmapId != invalidSampleId ? beatmapId : resolvedIds[i % numDefaultSamples];
+    }
+}
+
+SampleId SampleRegistry::resolveSampleId (SampleSet set, SampleType type, int index, const juce::String& filename) const
+{
+    const auto defaultId = getDefaultSampleId (set, type);
+
+    const juce::ScopedLock sl (lock);
+
+    if (filename.isNotEmpty() && beatmapDirectory != juce::File())
+    {
+        auto it = customIds.find (beatmapDirectory.getChildFile (filename).getFullPathName());
+        if (it != customIds.end())
+        {
+            touch (it->second);
+            return it->second;
+        }
+    }
+
+    const auto numRows = (int) (resolvedIds.size() / numDefaultSamples);
+    const int row = (index > 0 && index < numRows) ? index : 0;
+    const auto id = resolvedIds[(size_t) (row * numDefaultSamples + defaultId)];
+
+    touch (id);
+    return id;
 }
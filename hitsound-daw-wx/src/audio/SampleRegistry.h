@@ -1,33 +1,216 @@
 #pragma once
 
 #include <juce_audio_formats/juce_audio_formats.h>
+#include <array>
+#include <atomic>
+#include <functional>
 #include <map>
+#include <memory>
+#include <vector>
 #include "../model/SampleRef.h"
 
+// A hitsound decoded into memory at the playback sample rate.
+// Voices mix straight from this buffer, so the audio thread never touches the disk.
+struct CachedSample
+{
+    juce::AudioBuffer<float> buffer;
+    double sampleRate = 0.0;
+
+    int getNumSamples() const { return buffer.getNumSamples(); }
+    int getNumChannels() const { return buffer.getNumChannels(); }
+
+    // Peak and mean square of every meterWindow samples (all channels), computed
+    // once after rendering so track meters cost a few lookups per voice and block
+    static constexpr int meterWindow = 64;
+    std::vector<float> windowPeaks;
+    std::vector<float> windowMeanSquares;
+
+    void computeLevels();
+
+    // Peak and sum of squares (per channel) of [start, start + numSamples), to window precision
+    void getLevel (int start, int numSamples, float& peak, float& sumOfSquares) const noexcept;
+};
+
+// Dense handle for a registered sample. The built-in bank takes the first ids,
+// one per set/type pair; custom files are interned after them. Anything that
+// needs a sample per event resolves it by indexing with the id.
+using SampleId = int;
+constexpr SampleId invalidSampleId = -1;
+
+struct SampleCacheStats
+{
+    size_t memoryUsed = 0;    // Bytes held by decoded and rendered buffers, shared ones counted once
+    size_t memoryBudget = 0;
+    int numSamples = 0;       // Ids currently holding audio
+    int numShared = 0;        // Of those, how many share an identical file's buffers
+    int numEvicted = 0;       // Since startup
+    juce::int64 hits = 0;     // Adds served without decoding (same path or same content)
+    juce::int64 misses = 0;
+
+    double getHitRate() const { return hits + misses > 0 ? (double) hits / (double) (hits + misses) : 0.0; }
+};
+
+enum class ResampleQuality
+{
+    Linear,
+    WindowedSinc
+};
+
 class SampleRegistry
 {
 public:
     SampleRegistry();
+    ~SampleRegistry();
+
+    static constexpr int numSampleSets = 3;
+    static constexpr int numSampleTypes = 7;
+    static constexpr int numDefaultSamples = numSampleSets * numSampleTypes;
+
+    static SampleId getDefaultSampleId (SampleSet set, SampleType type)
+    {
+        return static_cast<int> (set) * numSampleTypes + static_cast<int> (type);
+    }
+
+    // Decodes the file once and returns its id; the same file always gets the same id.
+    // Returns invalidSampleId if the file can't be read.
+    SampleId addSample (const SampleRef& ref);
+
+    // Id of an already added file, or invalidSampleId
+    SampleId findSampleId (const juce::File& file) const;
+
+    // Returns nullptr until the sample has been rendered at the current rate at least once.
+    // Holders keep the buffer alive after the registry has replaced it.
+    std::shared_ptr<const CachedSample> getSample (SampleId id) const;
 
-    void addSample (const SampleRef& ref);
-    juce::AudioFormatReader* getReader (const SampleRef& ref);
+    // Every rendered sample indexed by id (nullptr for gaps), taken under a single lock.
+    std::vector<std::shared_ptr<const CachedSample>> getSampleTable() const;
 
     void loadDefaultSamples (const juce::File& dir);
-    int getDefaultSampleCount() const { return (int)defaultSamples.size(); }
+    int getDefaultSampleCount() const;
+
+    // Scans a beatmap folder for osu! custom samples (<set>-<type><index>.wav, e.g.
+    // soft-hitclap2.wav; no number means index 1) and decodes them, plus any files
+    // named explicitly by hitobjects, in parallel on the load pool. Returns
+    // straight away; onSamplesRendered fires once they are ready to play.
+    // Replaces the index table of the previously loaded beatmap.
+    void loadBeatmapSamples (const juce::File& beatmapDir, const juce::StringArray& namedFiles);
+
+    // osu! skin folder used between the beatmap's samples and the built-in bank.
+    // It is only scanned once a beatmap has been loaded, and only once per folder.
+    // An empty file disables it.
+    void setSkinDirectory (const juce::File& dir);
+    juce::File getSkinDirectory() const;
+
+    // Resolves a sample the way osu! does: an explicit filename from the beatmap
+    // folder first, then the beatmap's sample for a custom index of 1 or more,
+    // then the skin, then the built-in bank. The chain is flattened into a table
+    // whenever one of its sources changes, so this is a single lookup.
+    SampleId resolveSampleId (SampleSet set, SampleType type, int index, const juce::String& filename = {}) const;
+
+    // Resamples every sample to the given rate on the background render thread.
+    // Safe to call at any time; buffers already handed out stay valid.
+    void setSampleRate (double newSampleRate);
+    double getSampleRate() const;
+
+    void setResampleQuality (ResampleQuality newQuality);
+    ResampleQuality getResampleQuality() const;
+
+    // Blocks until every queued load and render has finished, for tools that render
+    // without an audio device. Returns false if it timed out first.
+    bool waitUntilIdle (int timeoutMs = -1) const;
+
+    // Custom samples not used by the current beatmap or skin are evicted, least
+    // recently used first, while the cache is over budget. Evicted ids stay valid
+    // and are decoded again if their file is added again. The built-in bank and
+    // buffers held by a schedule are never freed early.
+    static constexpr size_t defaultMemoryBudget = 256 * 1024 * 1024;
+    void setMemoryBudget (size_t bytes);
+    SampleCacheStats getCacheStats() const;
+
+    // Called on the render thread whenever new buffers have been installed, a
+    // batch of beatmap/skin samples has finished loading or the rate has changed.
+    // Set this before any samples are added.
+    std::function<void()> onSamplesRendered;
 
 private:
     struct SampleEntry
     {
-        SampleRef ref;
-        std::unique_ptr<juce::AudioFormatReader> reader;
+        juce::File file;
+
+        // Decoded file contents at the file's own rate, kept so a device rate
+        // change can be handled without going back to disk.
+        std::shared_ptr<const juce::AudioBuffer<float>> source;
+        double sourceSampleRate = 0.0;
+
+        std::shared_ptr<const CachedSample> sample;
+        int renderedGeneration = -1;
+
+        juce::String contentHash;           // MD5 of the file; identical files share buffers
+        mutable juce::int64 lastUsed = 0;   // Value of useClock when last added or resolved
     };
 
-    std::map<juce::String, SampleEntry> samples;
+    // Guards everything below; never taken on the audio thread
+    mutable juce::CriticalSection lock;
 
-    // Built-in samples keyed by "set-type" (e.g., "0-0" for normal-hitnormal)
-    std::map<juce::String, std::unique_ptr<juce::AudioFormatReader>> defaultSamples;
+    // Indexed by SampleId: the built-in bank first, then custom files in the order they were added
+    std::vector<SampleEntry> entries;
+    std::map<juce::String, SampleId> customIds;  // Full path -> id, only used when adding
+    std::map<juce::String, SampleId> idsByHash;  // Content hash -> an id holding that audio
+
+    size_t memoryBudget = defaultMemoryBudget;
+    mutable juce::int64 useClock = 0;
+    SampleCacheStats stats;
+
+    // The open beatmap's custom samples: beatmapIds[(index - 1) * numDefaultSamples + defaultId]
+    juce::File beatmapDirectory;
+    std::vector<SampleId> beatmapIds;
+    std::vector<SampleId> beatmapNamedIds;   // Files named by hitobjects
+    int beatmapGeneration = 0;
+
+    juce::File skinDirectory;
+    std::array<SampleId, numDefaultSamples> skinIds;
+    int skinGeneration = 0;
+    bool skinRequested = false;  // A scan of skinDirectory is queued, running or done
+    bool skinScanned = false;
+
+    // beatmap -> skin -> built-in, flattened: resolvedIds[index * numDefaultSamples + defaultId].
+    // Row 0 (skin or built-in) also serves indices the beatmap has no samples for.
+    std::vector<SampleId> resolvedIds;
+
+    // Loads of the current batch still running. A new beatmap starts a new batch;
+    // jobs of an abandoned one may still finish, but no longer count.
+    std::atomic<int> pendingLoads { 0 };
+    int loadBatch = 0;
+
+    double sampleRate = 44100.0;
+    ResampleQuality quality = ResampleQuality::WindowedSinc;
+
+    // Bumped whenever the rate or quality changes; stale render jobs bail out
+    std::atomic<int> renderGeneration { 0 };
 
     juce::AudioFormatManager formatManager;
 
-    static juce::String makeKey (const SampleRef& ref);
+    bool decodeFile (const juce::File& file, SampleEntry& entry);
+    SampleId internFile (const juce::File& file);
+    void finishLoad (int batch);
+    void loadSkinSamples();
+    void rebuildResolvedIds();
+
+    // Cache bookkeeping; the lock must be held
+    void touch (SampleId id) const { entries[(size_t) id].lastUsed = ++useClock; }
+    SampleId assignCustomId (const juce::String& path, SampleEntry entry);
+    SampleId findByContent (const juce::String& hash);
+    size_t computeMemoryUsed (int* numShared = nullptr) const;
+    void enforceMemoryBudget();
+
+    // notifyAlways: fire onSamplesRendered even if nothing needed rendering, because
+    // the resolution tables changed
+    void startRendering (bool notifyAlways = false);
+    void renderPending (int generation, double targetRate, ResampleQuality targetQuality, bool notifyAlways);
+    static std::shared_ptr<const CachedSample> render (const juce::AudioBuffer<float>& source, double sourceRate,
+                                                       double targetRate, ResampleQuality targetQuality);
+
+    // Declared last so pending jobs finish before the tables go away
+    juce::ThreadPool renderPool { juce::ThreadPoolOptions{}.withThreadName ("Sample render").withNumberOfThreads (1) };
+    juce::ThreadPool loadPool { juce::ThreadPoolOptions{}.withThreadName ("Sample load") };
 };
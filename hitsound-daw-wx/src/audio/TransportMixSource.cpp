@@ -0,0 +1,142 @@
+#include "TransportMixSource.h"
+
+TransportMixSource::TransportMixSource (juce::AudioTransportSource& transportToUse, EventPlaybackSource& eventsToUse,
+                                        AudioPerformanceMonitor& monitorToUse, LevelMeters& metersToUse)
+    : transport (transportToUse), events (eventsToUse), monitor (monitorToUse), meters (metersToUse)
+{
+}
+
+void TransportMixSource::setLoopRange (double startSeconds, double endSeconds)
+{
+    loopStartSeconds.store (startSeconds);
+    loopEndSeconds.store (endSeconds);
+}
+
+void TransportMixSource::setLoopCrossfade (double seconds)
+{
+    crossfadeSeconds.store (juce::jlimit (0.0, maxLoopCrossfadeSeconds, seconds));
+}
+
+void TransportMixSource::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
+{
+    currentSampleRate = sampleRate;
+    monitor.prepare (sampleRate);
+    meters.prepare (sampleRate);
+
+    transport.prepareToPlay (samplesPerBlockExpected, sampleRate);
+    events.prepareToPlay (samplesPerBlockExpected, sampleRate);
+
+    eventBuffer.setSize (2, samplesPerBlockExpected);
+    seamTail.setSize (2, (int) std::ceil (maxLoopCrossfadeSeconds * sampleRate));
+
+    crossfadeLength = 0;
+    crossfadePosition = 0;
+}
+
+void TransportMixSource::releaseResources()
+{
+    transport.releaseResources();
+    events.releaseResources();
+
+    eventBuffer.setSize (2, 0);
+    seamTail.setSize (2, 0);
+}
+
+void TransportMixSource::getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+
+    // Devices may deliver larger blocks than announced; this only reallocates if so
+    eventBuffer.setSize (juce::jmax (1, bufferToFill.buffer->getNumChannels()), bufferToFill.numSamples, false, false, true);
+
+    const double startSeconds = loopStartSeconds.load();
+    const auto loopStart = (int64_t) std::llround (startSeconds * currentSampleRate);
+    const auto loopEnd = (int64_t) std::llround (loopEndSeconds.load() * currentSampleRate);
+
+    const bool canLoop = looping.load() && transport.isPlaying() && transport.getTotalLength() > 0
+                      && loopStart >= 0 && loopEnd > loopStart;
+
+    int done = 0;
+
+    while (done < bufferToFill.numSamples)
+    {
+        int length = bufferToFill.numSamples - done;
+        bool reachesLoopEnd = false;
+
+        if (canLoop)
+        {
+            // Looping was switched on (or the region moved) behind the playhead: jump back now
+            if (transport.getNextReadPosition() >= loopEnd)
+                wrapLoop (startSeconds, loopStart, false);
+
+            const auto untilLoopEnd = loopEnd - transport.getNextReadPosition();
+
+            if (untilLoopEnd > 0 && untilLoopEnd <= length)
+            {
+                length = (int) untilLoopEnd;
+                reachesLoopEnd = true;
+            }
+        }
+
+        renderSegment (bufferToFill, done, length);
+        done += length;
+
+        if (reachesLoopEnd)
+            wrapLoop (startSeconds, loopStart, true);
+    }
+
+    meters.endBlock (bufferToFill.numSamples);
+    monitor.record (startTicks, juce::Time::getHighResolutionTicks(), bufferToFill.numSamples, events.takePeakVoices());
+}
+
+void TransportMixSource::renderSegment (const juce::AudioSourceChannelInfo& bufferToFill, int offset, int numSamples)
+{
+    const juce::AudioSourceChannelInfo songInfo (bufferToFill.buffer, bufferToFill.startSample + offset, numSamples);
+    transport.getNextAudioBlock (songInfo);
+
+    if (crossfadePosition < crossfadeLength)
+        applyCrossfade (*bufferToFill.buffer, songInfo.startSample, numSamples);
+
+    meters.addBus (LevelMeters::songBus, *bufferToFill.buffer, songInfo.startSample, numSamples);
+
+    const juce::AudioSourceChannelInfo eventInfo (&eventBuffer, offset, numSamples);
+    events.getNextAudioBlock (eventInfo);
+    meters.addBus (LevelMeters::effectsBus, eventBuffer, offset, numSamples);
+
+    for (int ch = 0; ch < bufferToFill.buffer->getNumChannels(); ++ch)
+        bufferToFill.buffer->addFrom (ch, songInfo.startSample, eventBuffer, ch, offset, numSamples);
+
+    meters.addBus (LevelMeters::masterBus, *bufferToFill.buffer, songInfo.startSample, numSamples);
+}
+
+void TransportMixSource::wrapLoop (double startSeconds, int64_t startSample, bool crossfade)
+{
+    const int fadeLength = crossfade ? juce::jmin (seamTail.getNumSamples(), (int) std::llround (crossfadeSeconds.load() * currentSampleRate))
+                                     : 0;
+
+    // Render the song a little past the loop end; it fades out over the start of the next pass
+    if (fadeLength > 0)
+        transport.getNextAudioBlock (juce::AudioSourceChannelInfo (&seamTail, 0, fadeLength));
+
+    crossfadeLength = fadeLength;
+    crossfadePosition = 0;
+
+    transport.setNextReadPosition (startSample);
+    events.seekTo (startSeconds);
+}
+
+void TransportMixSource::applyCrossfade (juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    const int count = juce::jmin (numSamples, crossfadeLength - crossfadePosition);
+    const float fadeInStart = (float) crossfadePosition / (float) crossfadeLength;
+    const float fadeInEnd = (float) (crossfadePosition + count) / (float) crossfadeLength;
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+    {
+        buffer.applyGainRamp (ch, startSample, count, fadeInStart, fadeInEnd);
+        buffer.addFromWithRamp (ch, startSample, seamTail.getReadPointer (ch % seamTail.getNumChannels(), crossfadePosition),
+                                count, 1.0f - fadeInStart, 1.0f - fadeInEnd);
+    }
+
+    crossfadePosition += count;
+}
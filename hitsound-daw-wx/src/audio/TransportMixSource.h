@@ -0,0 +1,58 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_devices/juce_audio_devices.h>
+#include <atomic>
+#include "AudioPerformanceMonitor.h"
+#include "EventPlaybackSource.h"
+#include "LevelMeters.h"
+
+// Mixes the master track with the hitsound events and handles looping inside
+// the audio callback. When a block crosses the loop end it is split at that
+// exact sample: the part before the seam is rendered, both the transport and
+// the event clock are moved back to the loop start, and the rest is rendered
+// from there. An optional short crossfade smooths the seam in the song audio.
+// Every callback is timed into the AudioPerformanceMonitor, and the song,
+// hitsound and output buses are metered into LevelMeters.
+class TransportMixSource : public juce::AudioSource
+{
+public:
+    TransportMixSource (juce::AudioTransportSource& transport, EventPlaybackSource& events,
+                        AudioPerformanceMonitor& monitor, LevelMeters& meters);
+
+    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    // Loop region in transport seconds. Safe to call from any thread.
+    void setLooping (bool shouldLoop) { looping.store (shouldLoop); }
+    void setLoopRange (double startSeconds, double endSeconds);
+
+    // Length of the song crossfade at the loop seam; 0 turns it off
+    void setLoopCrossfade (double seconds);
+    static constexpr double maxLoopCrossfadeSeconds = 0.05;
+
+private:
+    juce::AudioTransportSource& transport;
+    EventPlaybackSource& events;
+    AudioPerformanceMonitor& monitor;
+    LevelMeters& meters;
+
+    std::atomic<bool> looping { false };
+    std::atomic<double> loopStartSeconds { 0.0 };
+    std::atomic<double> loopEndSeconds { 0.0 };
+    std::atomic<double> crossfadeSeconds { 0.0 };
+
+    double currentSampleRate { 44100.0 };
+
+    // Preallocated in prepareToPlay
+    juce::AudioBuffer<float> eventBuffer;
+    juce::AudioBuffer<float> seamTail;  // Song audio just past the loop end, faded out after the seam
+
+    int crossfadeLength { 0 };
+    int crossfadePosition { 0 };  // Equal to crossfadeLength when no crossfade is running
+
+    void renderSegment (const juce::AudioSourceChannelInfo& bufferToFill, int offset, int numSamples);
+    void wrapLoop (double startSeconds, int64_t startSample, bool crossfade);
+    void applyCrossfade (juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+};
@@ -0,0 +1,172 @@
+#include "VoicePool.h"
+
+VoicePool& VoicePool::operator= (const VoicePool& other)
+{
+    voices = other.voices;
+    numActive = other.numActive;
+    numPlaying = other.numPlaying;
+    nextStartOrder = other.nextStartOrder;
+    polyphony.store (other.getPolyphony(), std::memory_order_relaxed);
+    return *this;
+}
+
+void VoicePool::setPolyphony (int numVoices)
+{
+    polyphony.store (juce::jlimit (1, maxVoices, numVoices), std::memory_order_relaxed);
+}
+
+Voice& VoicePool::start (const CachedSample* sample, float gain, int startOffset)
+{
+    // Also trims the pool down if the cap was lowered while voices were playing
+    while (numPlaying >= getPolyphony())
+    {
+        voices[(size_t) findVoiceToSteal (false)].releasing = true;
+        --numPlaying;
+    }
+
+    // Out of slots altogether: cut a voice outright, preferring one already fading
+    if (numActive == maxVoices)
+        retire (findVoiceToSteal (true));
+
+    auto& voice = voices[(size_t) numActive++];
+    ++numPlaying;
+
+    voice.sample = sample;
+    voice.position = 0;
+    voice.gain = gain;
+    voice.output.reset (gain);
+    voice.releasing = false;
+    voice.startOffset = startOffset;
+    voice.startOrder = nextStartOrder++;
+    voice.meterSlot = -1;
+    return voice;
+}
+
+void VoicePool::retire (int index)
+{
+    jassert (index >= 0 && index < numActive);
+
+    if (! voices[(size_t) index].releasing)
+        --numPlaying;
+
+    voices[(size_t) index] = voices[(size_t) (numActive - 1)];
+    --numActive;
+}
+
+uint64_t VoicePool::getOldestStartOrder() const
+{
+    uint64_t oldest = nextStartOrder;
+
+    for (int i = 0; i < numActive; ++i)
+        oldest = juce::jmin (oldest, voices[(size_t) i].startOrder);
+
+    return oldest;
+}
+
+int VoicePool::findVoiceToSteal (bool includeReleasing) const
+{
+    // Hitsounds decay, so gain scaled by the fraction left to play is a cheap loudness estimate
+    auto loudness = [] (const Voice& v)
+    {
+        if (v.releasing)
+            return 0.0f;
+
+        const int length = v.sample->getNumSamples();
+        return length > 0 ? v.gain * (float) (length - v.position) / (float) length : 0.0f;
+    };
+
+    int quietest = -1;
+
+    for (int i = 0; i < numActive; ++i)
+    {
+        const auto& candidate = voices[(size_t) i];
+
+        if (candidate.releasing && ! includeReleasing)
+            continue;
+
+        if (quietest < 0)
+        {
+            quietest = i;
+            continue;
+        }
+
+        const auto& current = voices[(size_t) quietest];
+        const float candidateLoudness = loudness (candidate);
+        const float currentLoudness = loudness (current);
+
+        if (candidateLoudness < currentLoudness
+            || (candidateLoudness == currentLoudness && candidate.startOrder < current.startOrder))
+            quietest = i;
+    }
+
+    jassert (quietest >= 0);
+    return juce::jmax (0, quietest);
+}
+
+size_t VoicePool::startTriggers (const PlaybackSchedule& schedule, size_t cursor, int64_t startSample, int numSamples, float masterGain)
+{
+    const auto& triggers = schedule.getTriggers();
+    const auto endSample = startSample + numSamples;
+
+    while (cursor < triggers.size() && triggers[cursor].samplePosition < endSample)
+    {
+        const auto& trigger = triggers[cursor++];
+        int startOffset = (int) (trigger.samplePosition - startSample);
+        auto& voice = start (schedule.getSample (trigger.sample), trigger.gain, startOffset);
+        voice.output.reset (trigger.gain * masterGain);
+        voice.meterSlot = trigger.meterSlot;
+    }
+
+    return cursor;
+}
+
+void VoicePool::render (juce::AudioBuffer<float>* dest, int destStart, int numSamples, float masterGain,
+                        LevelMeters* meters)
+{
+    for (int i = 0; i < numActive;)
+    {
+        auto& voice = voices[(size_t) i];
+
+        int destOffset = 0;
+        int count = numSamples;
+
+        if (voice.startOffset > 0)
+        {
+            destOffset = voice.startOffset;
+            count -= voice.startOffset;
+            voice.startOffset = 0;
+        }
+
+        // Never read past the end of the sample
+        count = juce::jmin (count, voice.sample->getNumSamples() - voice.position);
+
+        if (count > 0)
+        {
+            // Stolen voices fade to silence; gain changes ramp instead of jumping
+            voice.output.setTarget (voice.releasing ? 0.0f : voice.gain * masterGain);
+            const float startGain = voice.output.gain;
+
+            if (dest != nullptr)
+                MixKernel::mixVoice (*dest, destStart + destOffset, voice.sample->buffer, voice.position, count, voice.output);
+            else
+                voice.output.advance (count);
+
+            if (meters != nullptr)
+            {
+                float peak, sumOfSquares;
+                voice.sample->getLevel (voice.position, count, peak, sumOfSquares);
+
+                const float gain = juce::jmax (startGain, voice.output.gain);
+                meters->addVoice (voice.meterSlot, peak * gain, sumOfSquares * gain * gain);
+            }
+
+            voice.position += count;
+        }
+
+        // Retiring swaps the last voice into this slot, so only advance when keeping it
+        if (voice.position >= voice.sample->getNumSamples() || (voice.releasing && voice.output.gain == 0.0f))
+            retire (i);
+        else
+            ++i;
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include "LevelMeters.h"
+#include "MixKernel.h"
+#include "PlaybackSchedule.h"
+#include "SampleRegistry.h"
+
+// A cached sample being mixed by EventPlaybackSource
+struct Voice
+{
+    const CachedSample* sample = nullptr;
+    int position = 0;
+    float gain = 0.0f;
+    MixKernel::GainRamp output;  // Gain actually applied, ramping toward gain * master
+    bool releasing = false;    // Stolen; fading out before it is retired
+    int startOffset = 0;       // Samples to delay before starting playback
+    uint64_t startOrder = 0;   // Lower means started earlier
+    int meterSlot = -1;        // Track it is metered on; see LevelMeters
+};
+
+// Fixed-capacity set of active voices for the audio thread.
+// All storage lives inside the pool, so starting and retiring voices is O(1)
+// and never allocates. Once the polyphony cap is reached, starting a voice
+// steals the quietest one (the oldest on a tie). A stolen voice is marked as
+// releasing and keeps its slot while it fades out, so steals don't click.
+class VoicePool
+{
+public:
+    static constexpr int maxVoices = 256;
+    static constexpr int defaultPolyphony = 64;
+
+    VoicePool() = default;
+
+    // Copies the whole playback state; OfflineRenderer snapshots it at chunk boundaries
+    VoicePool (const VoicePool& other) { *this = other; }
+    VoicePool& operator= (const VoicePool& other);
+
+    // Safe from any thread; takes effect at the next start()
+    void setPolyphony (int numVoices);
+    int getPolyphony() const { return polyphony.load (std::memory_order_relaxed); }
+
+    // Audio thread only
+    Voice& start (const CachedSample* sample, float gain, int startOffset);
+    void retire (int index);  // Moves the last voice into 'index'
+    void clear() { numActive = 0; numPlaying = 0; }
+
+    // Starts the schedule's triggers in [startSample, startSample + numSamples),
+    // beginning at cursor. Returns the cursor for the next block.
+    size_t startTriggers (const PlaybackSchedule& schedule, size_t cursor, int64_t startSample, int numSamples, float masterGain);
+
+    // Mixes every voice into dest and retires the ones that have finished. With a
+    // null dest the voices only advance, exactly as if they had been mixed.
+    // Each voice's level is added to its track's meter when meters are given.
+    void render (juce::AudioBuffer<float>* dest, int destStart, int numSamples, float masterGain,
+                 LevelMeters* meters = nullptr);
+
+    int size() const { return numActive; }
+    bool isEmpty() const { return numActive == 0; }
+    Voice& operator[] (int index) { return voices[(size_t) index]; }
+
+    // Start order the next voice will get, and the oldest one still playing
+    // (equal to getNextStartOrder() when the pool is empty)
+    uint64_t getNextStartOrder() const { return nextStartOrder; }
+    uint64_t getOldestStartOrder() const;
+
+private:
+    std::array<Voice, maxVoices> voices {};
+    int numActive = 0;
+    int numPlaying = 0;  // Active voices that are not releasing
+    uint64_t nextStartOrder = 0;
+
+    std::atomic<int> polyphony { defaultPolyphony };
+
+    int findVoiceToSteal (bool includeReleasing) const;
+};
@@ -0,0 +1,174 @@
+#include "WaveformBuilder.h"
+
+namespace
+{
+    constexpr int readChunkSize = 65536;        // A multiple of the finest bin size
+    constexpr juce::uint32 updateIntervalMs = 200;
+}
+
+WaveformBuilder::WaveformBuilder()
+    : juce::Thread ("Waveform builder")
+{
+    formatManager.registerBasicFormats();
+}
+
+WaveformBuilder::~WaveformBuilder()
+{
+    stopThread (4000);
+}
+
+void WaveformBuilder::start (const juce::File& audioFile)
+{
+    stopThread (4000);
+
+    {
+        const juce::ScopedLock sl (lock);
+        file = audioFile;
+        pyramid = nullptr;
+    }
+
+    startThread (juce::Thread::Priority::low);
+}
+
+void WaveformBuilder::clear()
+{
+    stopThread (4000);
+
+    const juce::ScopedLock sl (lock);
+    file = juce::File();
+    pyramid = nullptr;
+}
+
+void WaveformBuilder::setCacheDirectory (const juce::File& directory)
+{
+    const juce::ScopedLock sl (lock);
+    cacheDirectory = directory;
+}
+
+std::shared_ptr<const WaveformPyramid> WaveformBuilder::getPyramid() const
+{
+    const juce::ScopedLock sl (lock);
+    return pyramid;
+}
+
+void WaveformBuilder::publish (std::shared_ptr<const WaveformPyramid> newPyramid)
+{
+    {
+        const juce::ScopedLock sl (lock);
+        pyramid = std::move (newPyramid);
+    }
+
+    notify();
+}
+
+void WaveformBuilder::notify()
+{
+    if (onUpdate)
+        onUpdate();
+}
+
+void WaveformBuilder::run()
+{
+    juce::File cacheFile;
+
+    {
+        const juce::ScopedLock sl (lock);
+        if (cacheDirectory != juce::File() && file.existsAsFile())
+            cacheFile = cacheDirectory.getChildFile (juce::MD5 (file).toHexString() + ".peaks");
+    }
+
+    if (cacheFile.existsAsFile())
+    {
+        if (auto cached = loadFromCache (cacheFile))
+        {
+            DBG("WaveformBuilder: Loaded cached waveform: " + cacheFile.getFileName());
+            publish (std::move (cached));
+            return;
+        }
+    }
+
+    auto built = build();
+    if (built == nullptr || threadShouldExit())
+        return;
+
+    if (cacheFile != juce::File())
+        saveToCache (*built, cacheFile);
+}
+
+std::shared_ptr<const WaveformPyramid> WaveformBuilder::loadFromCache (const juce::File& cacheFile) const
+{
+    juce::FileInputStream in (cacheFile);
+    if (! in.openedOk())
+        return nullptr;
+
+    return WaveformPyramid::readFrom (in);
+}
+
+std::shared_ptr<const WaveformPyramid> WaveformBuilder::build()
+{
+    juce::File audioFile;
+
+    {
+        const juce::ScopedLock sl (lock);
+        audioFile = file;
+    }
+
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (audioFile));
+    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->numChannels == 0)
+    {
+        DBG("WaveformBuilder: Can't read " + audioFile.getFileName());
+        return nullptr;
+    }
+
+    // Published straight away so the timeline can draw bins as they arrive
+    auto building = std::make_shared<WaveformPyramid> (reader->sampleRate, reader->lengthInSamples);
+    publish (building);
+
+    const int numChannels = (int) juce::jmin (2u, reader->numChannels);
+    juce::AudioBuffer<float> chunk (numChannels, readChunkSize);
+    auto lastUpdate = juce::Time::getMillisecondCounter();
+
+    for (juce::int64 position = 0; position < reader->lengthInSamples; position += readChunkSize)
+    {
+        if (threadShouldExit())
+            return nullptr;
+
+        const int num = (int) juce::jmin ((juce::int64) readChunkSize, reader->lengthInSamples - position);
+        reader->read (&chunk, 0, num, position, true, numChannels > 1);
+        building->addSamples (chunk.getArrayOfReadPointers(), numChannels, num);
+
+        const auto now = juce::Time::getMillisecondCounter();
+        if (now - lastUpdate >= updateIntervalMs)
+        {
+            lastUpdate = now;
+            notify();
+        }
+    }
+
+    building->finish();
+    notify();
+
+    DBG("WaveformBuilder: Built waveform for " + audioFile.getFileName());
+    return building;
+}
+
+void WaveformBuilder::saveToCache (const WaveformPyramid& finished, const juce::File& cacheFile)
+{
+    if (! cacheFile.getParentDirectory().createDirectory().wasOk())
+        return;
+
+    // Written to a temporary file first so a crash never leaves a truncated cache behind
+    juce::TemporaryFile temp (cacheFile);
+
+    {
+        juce::FileOutputStream out (temp.getFile());
+        if (! out.openedOk())
+            return;
+
+        finished.writeTo (out);
+        out.flush();
+    }
+
+    if (! temp.overwriteTargetFileWithTemporary())
+        DBG("WaveformBuilder: Failed to write " + cacheFile.getFullPathName());
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <functional>
+#include <memory>
+#include "WaveformPyramid.h"
+
+// Builds the song's WaveformPyramid on a worker thread.
+// Finished pyramids are cached next to the user's data, keyed by the MD5 of
+// the audio file, so reopening a song skips decoding entirely.
+class WaveformBuilder : private juce::Thread
+{
+public:
+    WaveformBuilder();
+    ~WaveformBuilder() override;
+
+    // Cancels any build in progress and starts on the new file
+    void start (const juce::File& audioFile);
+    void clear();
+
+    // An empty directory disables the cache
+    void setCacheDirectory (const juce::File& directory);
+
+    // The pyramid being built, or nullptr before the file has been opened.
+    // Bins fill in while it's being built; see WaveformPyramid::getNumReadyBins().
+    std::shared_ptr<const WaveformPyramid> getPyramid() const;
+
+    // Called on the builder thread as bins are added (throttled) and once more when done
+    std::function<void()> onUpdate;
+
+private:
+    juce::AudioFormatManager formatManager;
+
+    mutable juce::CriticalSection lock;
+    juce::File file;
+    juce::File cacheDirectory;
+    std::shared_ptr<const WaveformPyramid> pyramid;
+
+    void run() override;
+    void publish (std::shared_ptr<const WaveformPyramid> newPyramid);
+    void notify();
+
+    std::shared_ptr<const WaveformPyramid> loadFromCache (const juce::File& cacheFile) const;
+    std::shared_ptr<const WaveformPyramid> build();
+    static void saveToCache (const WaveformPyramid& finished, const juce::File& cacheFile);
+
+    JUCE_DECLARE_NON_COPYABLE (WaveformBuilder)
+};
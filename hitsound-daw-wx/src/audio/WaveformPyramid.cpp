@@ -0,0 +1,151 @@
+#include "WaveformPyramid.h"
+
+namespace
+{
+    constexpr int cacheMagic = 0x57445348;  // "HSDW"
+    constexpr int cacheVersion = 1;
+}
+
+WaveformPyramid::WaveformPyramid (double rate, juce::int64 length)
+    : sampleRate (rate), lengthInSamples (juce::jmax ((juce::int64) 0, length))
+{
+    for (int level = 0; level < numLevels; ++level)
+    {
+        const auto binSize = (juce::int64) samplesPerBin[(size_t) level];
+        levels[(size_t) level].bins.resize ((size_t) ((lengthInSamples + binSize - 1) / binSize));
+    }
+}
+
+int WaveformPyramid::chooseLevel (double samplesPerPixel)
+{
+    for (int level = numLevels - 1; level > 0; --level)
+        if (samplesPerBin[(size_t) level] <= samplesPerPixel)
+            return level;
+
+    return 0;
+}
+
+void WaveformPyramid::Accumulator::merge (const Accumulator& other)
+{
+    if (other.numFrames == 0)
+        return;
+
+    min = numFrames == 0 ? other.min : juce::jmin (min, other.min);
+    max = numFrames == 0 ? other.max : juce::jmax (max, other.max);
+    sumSquares += other.sumSquares;
+    numValues += other.numValues;
+    numFrames += other.numFrames;
+}
+
+WaveformBin WaveformPyramid::Accumulator::toBin() const
+{
+    const float rms = numValues > 0 ? (float) std::sqrt (sumSquares / (double) numValues) : 0.0f;
+    return { min, max, rms };
+}
+
+void WaveformPyramid::completeBin (int level)
+{
+    auto& l = levels[(size_t) level];
+    const int index = l.numReady.load (std::memory_order_relaxed);
+
+    if (index < (int) l.bins.size())
+    {
+        l.bins[(size_t) index] = l.pending.toBin();
+        l.numReady.store (index + 1, std::memory_order_release);
+    }
+
+    if (level + 1 < numLevels)
+    {
+        auto& next = levels[(size_t) level + 1];
+        next.pending.merge (l.pending);
+
+        if (next.pending.numFrames >= samplesPerBin[(size_t) level + 1])
+            completeBin (level + 1);
+    }
+
+    l.pending.reset();
+}
+
+void WaveformPyramid::addSamples (const float* const* channels, int numChannels, int numSamples)
+{
+    auto& pending = levels[0].pending;
+    int offset = 0;
+
+    while (offset < numSamples)
+    {
+        const int num = juce::jmin (numSamples - offset, samplesPerBin[0] - pending.numFrames);
+
+        Accumulator chunk;
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const float* data = channels[ch] + offset;
+            const auto range = juce::FloatVectorOperations::findMinAndMax (data, num);
+
+            chunk.min = ch == 0 ? range.getStart() : juce::jmin (chunk.min, range.getStart());
+            chunk.max = ch == 0 ? range.getEnd() : juce::jmax (chunk.max, range.getEnd());
+
+            for (int i = 0; i < num; ++i)
+                chunk.sumSquares += (double) (data[i] * data[i]);
+        }
+
+        chunk.numValues = (juce::int64) num * numChannels;
+        chunk.numFrames = num;
+        pending.merge (chunk);
+
+        if (pending.numFrames >= samplesPerBin[0])
+            completeBin (0);
+
+        offset += num;
+    }
+}
+
+void WaveformPyramid::finish()
+{
+    // Coarser levels still hold whatever the finer ones passed up
+    for (int level = 0; level < numLevels; ++level)
+        if (levels[(size_t) level].pending.numFrames > 0)
+            completeBin (level);
+}
+
+void WaveformPyramid::writeTo (juce::OutputStream& out) const
+{
+    out.writeInt (cacheMagic);
+    out.writeInt (cacheVersion);
+    out.writeDouble (sampleRate);
+    out.writeInt64 (lengthInSamples);
+
+    for (const auto& level : levels)
+    {
+        const int numReady = level.numReady.load (std::memory_order_acquire);
+        out.writeInt (numReady);
+        out.write (level.bins.data(), sizeof (WaveformBin) * (size_t) numReady);
+    }
+}
+
+std::unique_ptr<WaveformPyramid> WaveformPyramid::readFrom (juce::InputStream& in)
+{
+    if (in.readInt() != cacheMagic || in.readInt() != cacheVersion)
+        return nullptr;
+
+    const double rate = in.readDouble();
+    const juce::int64 length = in.readInt64();
+    if (rate <= 0.0 || length <= 0)
+        return nullptr;
+
+    auto pyramid = std::make_unique<WaveformPyramid> (rate, length);
+
+    for (auto& level : pyramid->levels)
+    {
+        // Only complete pyramids are ever written
+        if (in.readInt() != (int) level.bins.size())
+            return nullptr;
+
+        const int numBytes = (int) (sizeof (WaveformBin) * level.bins.size());
+        if (in.read (level.bins.data(), numBytes) != numBytes)
+            return nullptr;
+
+        level.numReady.store ((int) level.bins.size(), std::memory_order_release);
+    }
+
+    return pyramid;
+}
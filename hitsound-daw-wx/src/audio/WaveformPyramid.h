@@ -0,0 +1,77 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+struct WaveformBin
+{
+    float min = 0.0f;
+    float max = 0.0f;
+    float rms = 0.0f;
+};
+
+// Min/max/RMS summaries of a song at several zoom levels.
+//
+// Every level is allocated at full size up front and filled front to back by a
+// single builder thread. Readers only look at the first getNumReadyBins() bins,
+// so the timeline can draw a waveform while it is still being built.
+class WaveformPyramid
+{
+public:
+    static constexpr int numLevels = 4;
+    static constexpr std::array<int, numLevels> samplesPerBin { 64, 256, 1024, 4096 };
+
+    WaveformPyramid (double sampleRate, juce::int64 lengthInSamples);
+
+    double getSampleRate() const { return sampleRate; }
+    juce::int64 getLengthInSamples() const { return lengthInSamples; }
+    double getDuration() const { return sampleRate > 0.0 ? (double) lengthInSamples / sampleRate : 0.0; }
+
+    int getNumBins (int level) const { return (int) levels[(size_t) level].bins.size(); }
+    int getNumReadyBins (int level) const { return levels[(size_t) level].numReady.load (std::memory_order_acquire); }
+    const WaveformBin& getBin (int level, int index) const { return levels[(size_t) level].bins[(size_t) index]; }
+    bool isComplete() const { return getNumReadyBins (0) == getNumBins (0); }
+
+    // Coarsest level that still has at least one bin per pixel
+    static int chooseLevel (double samplesPerPixel);
+
+    // Builder thread: feed the song in order, then call finish() to flush the last partial bins
+    void addSamples (const float* const* channels, int numChannels, int numSamples);
+    void finish();
+
+    // Sidecar cache format
+    void writeTo (juce::OutputStream& out) const;
+    static std::unique_ptr<WaveformPyramid> readFrom (juce::InputStream& in);
+
+private:
+    struct Accumulator
+    {
+        float min = 0.0f;
+        float max = 0.0f;
+        double sumSquares = 0.0;
+        juce::int64 numValues = 0;   // Channel samples, for the RMS
+        int numFrames = 0;
+
+        void reset() { *this = {}; }
+        void merge (const Accumulator& other);
+        WaveformBin toBin() const;
+    };
+
+    struct Level
+    {
+        std::vector<WaveformBin> bins;
+        std::atomic<int> numReady { 0 };
+        Accumulator pending;
+    };
+
+    const double sampleRate;
+    const juce::int64 lengthInSamples;
+    std::array<Level, numLevels> levels;
+
+    void completeBin (int level);
+
+    JUCE_DECLARE_NON_COPYABLE (WaveformPyramid)
+};
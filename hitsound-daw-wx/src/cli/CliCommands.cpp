@@ -0,0 +1,437 @@
+#include "CliCommands.h"
+#include "../io/OsuParser.h"
+#include "../io/ProjectSaver.h"
+#include "../model/ProjectValidator.h"
+#include "../audio/OfflineRenderer.h"
+#include "../audio/SampleRegistry.h"
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <map>
+
+namespace
+{
+    // Positional inputs plus "--name value" options and "--name" flags
+    struct Arguments
+    {
+        juce::StringArray inputs;
+        std::map<juce::String, juce::String> options;
+        juce::StringArray flags;
+
+        juce::String Get(const juce::String& name, const juce::String& fallback = {}) const
+        {
+            auto it = options.find(name);
+            return it != options.end() ? it->second : fallback;
+        }
+
+        bool Has(const juce::String& flag) const { return flags.contains(flag); }
+    };
+
+    Arguments ParseArguments(const juce::StringArray& args, const juce::StringArray& valueOptions)
+    {
+        Arguments parsed;
+
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+
+            if (valueOptions.contains(arg) && i + 1 < args.size())
+                parsed.options[arg] = args[++i];
+            else if (arg.startsWith("--"))
+                parsed.flags.add(arg);
+            else
+                parsed.inputs.add(arg);
+        }
+
+        return parsed;
+    }
+
+    std::vector<juce::File> CollectOsuFiles(const juce::StringArray& inputs)
+    {
+        std::vector<juce::File> files;
+
+        for (const auto& input : inputs)
+        {
+            juce::File path = juce::File::getCurrentWorkingDirectory().getChildFile(input);
+
+            if (path.isDirectory())
+            {
+                auto found = path.findChildFiles(juce::File::findFiles, true, "*.osu");
+                std::sort(found.begin(), found.end());
+                files.insert(files.end(), found.begin(), found.end());
+            }
+            else if (path.existsAsFile())
+            {
+                files.push_back(path);
+            }
+            else
+            {
+                std::cerr << "Not found: " << input.toStdString() << std::endl;
+            }
+        }
+
+        return files;
+    }
+
+    juce::String FormatTime(double seconds)
+    {
+        const auto totalMs = (juce::int64)std::llround(seconds * 1000.0);
+        return juce::String(totalMs / 60000) + ":" + juce::String((totalMs / 1000) % 60).paddedLeft('0', 2)
+             + "." + juce::String(totalMs % 1000).paddedLeft('0', 3);
+    }
+
+    struct FileReport
+    {
+        juce::String text;
+        bool ok = true;
+    };
+
+    // Runs the job on every file across all cores and prints the reports in input order.
+    // Returns the number of files whose report was not ok.
+    int ForEachFileParallel(const std::vector<juce::File>& files, const std::function<FileReport(const juce::File&)>& job)
+    {
+        std::vector<FileReport> reports(files.size());
+
+        {
+            juce::ThreadPool pool(juce::ThreadPoolOptions{}.withThreadName("hsd-cli")
+                                                           .withNumberOfThreads(juce::SystemStats::getNumCpus()));
+
+            for (size_t i = 0; i < files.size(); ++i)
+                pool.addJob([&, i] { reports[i] = job(files[i]); });
+
+            while (pool.getNumJobs() > 0)
+                juce::Thread::sleep(10);
+        }
+
+        int numFailed = 0;
+        for (const auto& report : reports)
+        {
+            std::cout << report.text.toStdString();
+            if (!report.ok)
+                ++numFailed;
+        }
+
+        return numFailed;
+    }
+
+    FileReport ParseFailure(const juce::File& file, const juce::String& error)
+    {
+        return { file.getFullPathName() + ": " + error + "\n", false };
+    }
+
+    int CountEvents(const Track& track)
+    {
+        int count = (int)track.events.size();
+        for (const auto& child : track.children)
+            count += CountEvents(child);
+        return count;
+    }
+
+    double LastEventTime(const Track& track)
+    {
+        double last = track.events.empty() ? 0.0 : track.events.Time(track.events.size() - 1);
+        for (const auto& child : track.children)
+            last = std::max(last, LastEventTime(child));
+        return last;
+    }
+
+    // --resources, else a Resources folder in the working directory or next to the executable
+    juce::File FindResources(const Arguments& args)
+    {
+        if (args.options.count("--resources"))
+            return juce::File::getCurrentWorkingDirectory().getChildFile(args.Get("--resources"));
+
+        juce::File exeDir = juce::File::getSpecialLocation(juce::File::currentExecutableFile).getParentDirectory();
+
+        for (auto dir : { juce::File::getCurrentWorkingDirectory(), exeDir, exeDir.getParentDirectory(),
+                          exeDir.getParentDirectory().getParentDirectory() })
+        {
+            if (dir.getChildFile("Resources").isDirectory())
+                return dir.getChildFile("Resources");
+        }
+
+        return {};
+    }
+
+    juce::File GetOutputDirectory(const Arguments& args)
+    {
+        if (!args.options.count("--out"))
+            return {};
+
+        auto dir = juce::File::getCurrentWorkingDirectory().getChildFile(args.Get("--out"));
+        return dir.createDirectory().wasOk() ? dir : juce::File();
+    }
+
+    // Where each input goes under outDir: its path relative to the folder input it
+    // was found in (just its name for file inputs), with the given extension
+    // ("" for none). Folders are searched recursively, so this keeps same-named
+    // beatmaps in different subfolders apart. Inputs that would still share a
+    // target map to juce::File() and are reported, rather than overwriting each other.
+    std::map<juce::File, juce::File> GetOutputFiles(const std::vector<juce::File>& files, const juce::StringArray& inputs,
+                                                    const juce::File& outDir, const juce::String& extension)
+    {
+        std::map<juce::File, juce::File> targets;
+        std::map<juce::File, int> numClaims;
+
+        for (const auto& file : files)
+        {
+            juce::String relativePath = file.getFileName();
+
+            for (const auto& input : inputs)
+            {
+                juce::File path = juce::File::getCurrentWorkingDirectory().getChildFile(input);
+                if (path.isDirectory() && file.isAChildOf(path))
+                {
+                    relativePath = file.getRelativePathFrom(path);
+                    break;
+                }
+            }
+
+            auto target = outDir.getChildFile(relativePath).withFileExtension(extension);
+            targets[file] = target;
+            ++numClaims[target];
+        }
+
+        for (auto& [file, target] : targets)
+        {
+            if (numClaims[target] > 1)
+            {
+                std::cerr << file.getFullPathName().toStdString() << ": another input also writes "
+                          << target.getFullPathName().toStdString() << std::endl;
+                target = juce::File();
+            }
+        }
+
+        return targets;
+    }
+}
+
+namespace CliCommands
+{
+    int Validate(const juce::StringArray& args)
+    {
+        auto files = CollectOsuFiles(ParseArguments(args, {}).inputs);
+        if (files.empty())
+        {
+            PrintUsage();
+            return 2;
+        }
+
+        int numFailed = ForEachFileParallel(files, [](const juce::File& file) {
+            juce::String parseError;
+            Project project = OsuParser::parse(file, &parseError);
+            if (parseError.isNotEmpty())
+                return ParseFailure(file, parseError);
+
+            auto errors = ProjectValidator::Validate(project);
+
+            FileReport report;
+            report.ok = errors.empty();
+            report.text = file.getFullPathName() + ": " + (errors.empty() ? juce::String("OK") : juce::String((int)errors.size()) + " errors") + "\n";
+
+            for (const auto& error : errors)
+                report.text += "  " + FormatTime(error.time) + "  " + juce::String(error.message) + "\n";
+
+            return report;
+        });
+
+        std::cout << files.size() - (size_t)numFailed << " of " << files.size() << " files valid" << std::endl;
+        return numFailed == 0 ? 0 : 1;
+    }
+
+    int Convert(const juce::StringArray& args)
+    {
+        auto parsed = ParseArguments(args, { "--out" });
+        auto files = CollectOsuFiles(parsed.inputs);
+        auto outDir = GetOutputDirectory(parsed);
+
+        if (files.empty() || outDir == juce::File())
+        {
+            PrintUsage();
+            return 2;
+        }
+
+        const auto targets = GetOutputFiles(files, parsed.inputs, outDir, ".osu");
+
+        int numFailed = ForEachFileParallel(files, [&](const juce::File& file) {
+            const auto target = targets.at(file);
+            if (target == juce::File())
+                return FileReport{ file.getFullPathName() + " -> FAILED (output name taken by another input)\n", false };
+
+            juce::String parseError;
+            Project project = OsuParser::parse(file, &parseError);
+            if (parseError.isNotEmpty())
+                return ParseFailure(file, parseError);
+
+            FileReport report;
+            report.ok = target.getParentDirectory().createDirectory().wasOk() && ProjectSaver::SaveProject(project, target);
+            report.text = file.getFullPathName() + " -> " + (report.ok ? target.getFullPathName() : juce::String("FAILED")) + "\n";
+            return report;
+        });
+
+        return numFailed == 0 ? 0 : 1;
+    }
+
+    int Render(const juce::StringArray& args)
+    {
+        auto parsed = ParseArguments(args, { "--out", "--resources", "--skin", "--rate", "--format", "--offset" });
+        auto files = CollectOsuFiles(parsed.inputs);
+        auto outDir = GetOutputDirectory(parsed);
+
+        if (files.empty() || outDir == juce::File())
+        {
+            PrintUsage();
+            return 2;
+        }
+
+        auto resources = FindResources(parsed);
+        if (!resources.isDirectory())
+        {
+            std::cerr << "Could not find the 'Resources' folder containing samples; pass --resources <dir>" << std::endl;
+            return 2;
+        }
+
+        const bool flac = parsed.Get("--format", "wav").equalsIgnoreCase("flac");
+        const bool stems = parsed.Has("--stems");
+
+        SampleRegistry registry;
+        registry.setSampleRate(parsed.Get("--rate", "44100").getDoubleValue());
+        registry.loadDefaultSamples(resources);
+
+        if (parsed.options.count("--skin"))
+            registry.setSkinDirectory(juce::File::getCurrentWorkingDirectory().getChildFile(parsed.Get("--skin")));
+
+        // Stems go in a folder per beatmap
+        const auto targets = GetOutputFiles(files, parsed.inputs, outDir, stems ? "" : (flac ? ".flac" : ".wav"));
+
+        // One beatmap at a time: each render already uses every core, and the
+        // registry holds one beatmap's sample table
+        int numFailed = 0;
+
+        for (const auto& file : files)
+        {
+            const auto target = targets.at(file);
+            if (target == juce::File())
+            {
+                std::cout << file.getFullPathName().toStdString() << ": output name taken by another input" << std::endl;
+                ++numFailed;
+                continue;
+            }
+
+            juce::String parseError;
+            Project project = OsuParser::parse(file, &parseError);
+            if (parseError.isNotEmpty())
+            {
+                std::cout << ParseFailure(file, parseError).text.toStdString();
+                ++numFailed;
+                continue;
+            }
+
+            juce::StringArray namedFiles;
+            std::function<void(const Track&)> collect = [&](const Track& track) {
+                if (!track.customFilename.empty())
+                    namedFiles.addIfNotAlreadyThere(juce::String(track.customFilename));
+                for (const auto& child : track.children)
+                    collect(child);
+            };
+            for (const auto& track : project.tracks)
+                collect(track);
+
+            registry.loadBeatmapSamples(file.getParentDirectory(), namedFiles);
+            registry.waitUntilIdle();
+
+            OfflineRenderer::Options options;
+            options.format = flac ? OfflineRenderer::Format::Flac : OfflineRenderer::Format::Wav;
+            options.offsetSeconds = parsed.Get("--offset", "0").getDoubleValue() / 1000.0;
+            options.songFile = file.getParentDirectory().getChildFile(juce::String(project.audioFilename));
+            options.content = parsed.Has("--hitsounds-only") || !options.songFile.existsAsFile()
+                                ? OfflineRenderer::Content::HitsoundsOnly
+                                : OfflineRenderer::Content::FullMix;
+
+            juce::Result result = juce::Result::ok();
+
+            if (stems)
+            {
+                result = OfflineRenderer::renderStems(project, registry, target, options, nullptr);
+            }
+            else
+            {
+                options.outputFile = target;
+                result = target.getParentDirectory().createDirectory();
+                if (result.wasOk())
+                    result = OfflineRenderer::render(project, registry, options, nullptr);
+            }
+
+            if (result.wasOk())
+            {
+                std::cout << file.getFullPathName().toStdString() << " -> " << target.getFullPathName().toStdString() << std::endl;
+            }
+            else
+            {
+                std::cout << file.getFullPathName().toStdString() << ": " << result.getErrorMessage().toStdString() << std::endl;
+                ++numFailed;
+            }
+        }
+
+        return numFailed == 0 ? 0 : 1;
+    }
+
+    int Stats(const juce::StringArray& args)
+    {
+        auto files = CollectOsuFiles(ParseArguments(args, {}).inputs);
+        if (files.empty())
+        {
+            PrintUsage();
+            return 2;
+        }
+
+        std::atomic<int> totalTracks { 0 };
+        std::atomic<int> totalEvents { 0 };
+
+        int numFailed = ForEachFileParallel(files, [&](const juce::File& file) {
+            juce::String parseError;
+            Project project = OsuParser::parse(file, &parseError);
+            if (parseError.isNotEmpty())
+                return ParseFailure(file, parseError);
+
+            int numEvents = 0;
+            double length = 0.0;
+            for (const auto& track : project.tracks)
+            {
+                numEvents += CountEvents(track);
+                length = std::max(length, LastEventTime(track));
+            }
+
+            totalTracks += (int)project.tracks.size();
+            totalEvents += numEvents;
+
+            FileReport report;
+            report.text = file.getFullPathName() + ": " + juce::String((int)project.tracks.size()) + " tracks, "
+                        + juce::String(numEvents) + " events, " + juce::String((int)project.timingPoints.size())
+                        + " timing points, last event at " + FormatTime(length) + "\n";
+            return report;
+        });
+
+        std::cout << files.size() << " files, " << totalTracks.load() << " tracks, " << totalEvents.load() << " events" << std::endl;
+        return numFailed == 0 ? 0 : 1;
+    }
+
+    void PrintUsage()
+    {
+        std::cout <<
+            "Usage: hsd-cli <command> [options] <.osu files or folders...>\n"
+            "\n"
+            "Commands:\n"
+            "  validate                     Check every file for hitsound conflicts\n"
+            "  convert --out <dir>          Re-save every file in hsd's hitsound format\n"
+            "  render --out <dir>           Bounce song + hitsounds to audio\n"
+            "      --format wav|flac        Output format (default wav)\n"
+            "      --hitsounds-only         Leave the song out\n"
+            "      --stems                  One file per track, in a folder per beatmap\n"
+            "      --rate <hz>              Sample rate (default 44100)\n"
+            "      --offset <ms>            Hitsound offset against the song (default 0)\n"
+            "      --resources <dir>        Built-in samples (default: find 'Resources')\n"
+            "      --skin <dir>             Skin folder used before the built-in samples\n"
+            "  stats                        Track, event and timing point counts\n";
+    }
+}
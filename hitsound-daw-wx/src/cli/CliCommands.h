@@ -0,0 +1,23 @@
+#pragma once
+#include <juce_core/juce_core.h>
+
+// Subcommands of hsd-cli. Each takes the arguments after the subcommand name,
+// prints its report to stdout and returns the process exit code.
+// Inputs are .osu files or folders (searched recursively for .osu files);
+// every subcommand but render works on the files in parallel.
+namespace CliCommands
+{
+    // Runs ProjectValidator on each file. Fails if any file has errors.
+    int Validate(const juce::StringArray& args);
+
+    // Parses each file and saves it again with ProjectSaver into --out <dir>
+    int Convert(const juce::StringArray& args);
+
+    // Bounces each file's song + hitsounds into --out <dir> (see OfflineRenderer)
+    int Render(const juce::StringArray& args);
+
+    // Track, event and timing point counts per file, plus totals
+    int Stats(const juce::StringArray& args);
+
+    void PrintUsage();
+}
@@ -0,0 +1,31 @@
+#include "CliCommands.h"
+#include <map>
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        CliCommands::PrintUsage();
+        return 2;
+    }
+
+    const std::map<juce::String, int (*)(const juce::StringArray&)> commands = {
+        { "validate", CliCommands::Validate },
+        { "convert", CliCommands::Convert },
+        { "render", CliCommands::Render },
+        { "stats", CliCommands::Stats }
+    };
+
+    auto it = commands.find(juce::String(argv[1]));
+    if (it == commands.end())
+    {
+        CliCommands::PrintUsage();
+        return 2;
+    }
+
+    juce::StringArray args;
+    for (int i = 2; i < argc; ++i)
+        args.add(juce::String::fromUTF8(argv[i]));
+
+    return it->second(args);
+}
@@ -1,8 +1,9 @@
 #include "OsuParser.h"
 #include <map>
 #include <algorithm>
+#include <tuple>
 
-static std::string getTrackKey(SampleSet set, SampleType type, const std::string& filename)
+static std::string getTrackKey(SampleSet set, SampleType type, int index, const std::string& filename)
 {
     if (!filename.empty())
         return filename;
@@ -23,20 +24,34 @@ static std::string getTrackKey(SampleSet set, SampleType type, const std::string
         default: typeStr = "other"; break;
     }
 
-    return setStr + "-" + typeStr;
+    // Custom samples get their own track, e.g. "soft-hitclap #2"
+    std::string key = setStr + "-" + typeStr;
+    if (index > 0)
+        key += " #" + std::to_string(index);
+    return key;
 }
 
-Project OsuParser::parse(const juce::File& file)
+Project OsuParser::parse(const juce::File& file, juce::String* error)
 {
     Project project;
-    if (!file.existsAsFile())
-        return project;
+    auto fail = [&](const juce::String& message) {
+        if (error) *error = message;
+        return Project();
+    };
 
-    project.projectDirectory = file.getParentDirectory().getFullPathName().toStdString();
-    project.projectFilePath = file.getFullPathName().toStdString();
+    if (!file.existsAsFile())
+        return fail("File not found");
 
     juce::StringArray lines;
     file.readLines(lines);
+    lines.removeEmptyStrings();
+
+    // osu! itself rejects files that don't start with the format line
+    if (lines.isEmpty() || !lines[0].trim().removeCharacters(juce::String::charToString(0xfeff)).startsWith("osu file format"))
+        return fail("Not an osu! beatmap (missing 'osu file format' header)");
+
+    project.projectDirectory = file.getParentDirectory().getFullPathName().toStdString();
+    project.projectFilePath = file.getFullPathName().toStdString();
 
     using TimingPoint = Project::TimingPoint;
     std::vector<TimingPoint> timingPoints;
@@ -85,6 +100,7 @@ Project OsuParser::parse(const juce::File& file)
                 tp.beatLength = parts[1].getDoubleValue();
                 tp.uninherited = (tp.beatLength > 0);
                 tp.sampleSet = (parts.size() >= 4) ? parts[3].getIntValue() : 1;
+                tp.sampleIndex = (parts.size() >= 5) ? parts[4].getIntValue() : 0;
                 tp.volume = (parts.size() >= 6) ? parts[5].getIntValue() : 100.0;
                 timingPoints.push_back(tp);
 
@@ -103,24 +119,20 @@ Project OsuParser::parse(const juce::File& file)
 
     project.timingPoints = timingPoints;
 
-    // Lambda to get timing point state at a given time
-    auto getStateAt = [&](double time) -> std::pair<int, double> {
-         int sSet = 1;
-         double vol = 100.0;
+    // Lambda to get timing point state (sample set, custom index, volume) at a given time
+    auto getStateAt = [&](double time) -> std::tuple<int, int, double> {
          for (auto it = timingPoints.rbegin(); it != timingPoints.rend(); ++it) {
-             if (it->time <= time) {
-                 sSet = it->sampleSet;
-                 vol = it->volume;
-                 return {sSet, vol};
-             }
+             if (it->time <= time)
+                 return {it->sampleSet, it->sampleIndex, it->volume};
          }
-         return {sSet, vol};
+         return {1, 0, 100.0};
     };
 
     // Build track hierarchy from hit objects
     struct TrackData {
         SampleSet set;
         SampleType type;
+        int index;
         std::string filename;
         std::map<int, std::vector<Event>> eventsByVolume;
     };
@@ -145,6 +157,7 @@ Project OsuParser::parse(const juce::File& file)
 
                 int normalSet = 0;
                 int additionSet = 0;
+                int index = 0;
                 int volume = 0;
                 std::string filename = "";
 
@@ -153,12 +166,14 @@ Project OsuParser::parse(const juce::File& file)
                    auto indentParts = juce::StringArray::fromTokens(parts[parts.size()-1], ":", "");
                    if (indentParts.size() >= 1) normalSet = indentParts[0].getIntValue();
                    if (indentParts.size() >= 2) additionSet = indentParts[1].getIntValue();
+                   if (indentParts.size() >= 3) index = indentParts[2].getIntValue();
                    if (indentParts.size() >= 4) volume = indentParts[3].getIntValue();
                    if (indentParts.size() >= 5) filename = indentParts[4].toStdString();
                 }
 
-                auto [inheritedSet, inheritedVol] = getStateAt(time);
+                auto [inheritedSet, inheritedIndex, inheritedVol] = getStateAt(time);
                 if (volume == 0) volume = (int)inheritedVol;
+                if (index == 0) index = inheritedIndex;
 
                 // Resolve sample set (0 = inherit from timing point or project default)
                 auto resolve = [&](int val) {
@@ -177,12 +192,13 @@ Project OsuParser::parse(const juce::File& file)
                 SampleSet finalAddSet = (additionSet == 0) ? finalBaseSet : resolve(additionSet);
 
                 auto addEvent = [&](SampleSet s, SampleType ty, const std::string& fn, double vol) {
-                    std::string key = getTrackKey(s, ty, fn);
+                    std::string key = getTrackKey(s, ty, index, fn);
 
                     if (hierarchy.find(key) == hierarchy.end()) {
                         TrackData td;
                         td.set = s;
                         td.type = ty;
+                        td.index = index;
                         td.filename = fn;
                         hierarchy[key] = td;
                     }
@@ -214,6 +230,7 @@ Project OsuParser::parse(const juce::File& file)
         parent.name = key;
         parent.sampleSet = data.set;
         parent.sampleType = data.type;
+        parent.sampleIndex = data.index;
         parent.customFilename = data.filename;
         parent.isExpanded = false;
 
@@ -223,8 +240,9 @@ Project OsuParser::parse(const juce::File& file)
             child.name = parent.name + " (" + std::to_string(vol) + "%)";
             child.sampleSet = data.set;
             child.sampleType = data.type;
+            child.sampleIndex = data.index;
             child.customFilename = data.filename;
-            child.events = events;
+            child.events.Assign(events);
             child.gain = (float)vol / 100.0f;
             child.isChildTrack = true;
             parent.children.push_back(child);
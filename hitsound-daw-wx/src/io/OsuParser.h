@@ -8,7 +8,9 @@
 class OsuParser
 {
 public:
-    static Project parse(const juce::File& file);
+    // Returns an empty project if the file can't be read or has no "osu file format"
+    // header; error (if given) then says which
+    static Project parse(const juce::File& file, juce::String* error = nullptr);
     
     // Creates a new hitsound difficulty by copying timing points from reference
     static bool CreateHitsoundDiff(const juce::File& referenceFile, const juce::File& targetFile);
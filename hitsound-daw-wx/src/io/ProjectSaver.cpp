@@ -1,10 +1,9 @@
 #include "ProjectSaver.h"
-#include <map>
 #include <vector>
 #include <algorithm>
+#include <cmath>
 #include <iomanip>
 #include <sstream>
-#include <functional>
 
 bool ProjectSaver::SaveProject(const Project& project, const juce::File& file)
 {
@@ -86,7 +85,7 @@ bool ProjectSaver::SaveProject(const Project& project, const juce::File& file)
         content += juce::String(tp.beatLength) + ",";
         content += "4,";
         content += juce::String(tp.sampleSet) + ",";
-        content += "0,";
+        content += juce::String(tp.sampleIndex) + ",";
         content += juce::String((int)tp.volume) + ",";
         content += (tp.uninherited ? "1" : "0") + juce::String(",");
         content += "0";
@@ -109,16 +108,19 @@ juce::String ProjectSaver::GenerateHitObjectsSection(const Project& project)
         int bitmask = 0;
         int normalSet = 0;
         int additionSet = 0;
+        int index = 0;
         int volume = 0;
         std::string filename;
     };
 
-    std::map<int, MergedEvent> timeMap;
+    // The project's time index already groups events by millisecond, in order
+    for (const auto& [timeMs, refs] : project.GetTimeIndex())
+    {
+        MergedEvent data;
 
-    std::function<void(const Track&)> processTrack = [&](const Track& track) {
-        for (const auto& ev : track.events)
+        for (const auto& ref : refs)
         {
-            int timeMs = (int)(ev.time * 1000.0 + 0.5);
+            const Track& track = *ref.track;
 
             // Convert SampleSet to .osu format (1=normal, 2=soft, 3=drum)
             int setVal = 1;
@@ -135,36 +137,25 @@ juce::String ProjectSaver::GenerateHitObjectsSection(const Project& project)
                 default: break;
             }
 
-            auto& merged = timeMap[timeMs];
-
             if (track.sampleType == SampleType::HitNormal) {
-                merged.normalSet = setVal;
+                data.normalSet = setVal;
             } else {
-                merged.additionSet = setVal;
+                data.additionSet = setVal;
             }
 
-            merged.bitmask |= mask;
+            data.bitmask |= mask;
+
+            int evVol = (int)std::lround(ref.volume * 100.0);
+            if (evVol > data.volume) data.volume = evVol;
 
-            int evVol = (int)(ev.volume * 100.0);
-            if (evVol > merged.volume) merged.volume = evVol;
+            // A hitobject has a single custom index; the highest one wins
+            if (track.sampleIndex > data.index) data.index = track.sampleIndex;
 
             if (!track.customFilename.empty()) {
-                merged.filename = track.customFilename;
+                data.filename = track.customFilename;
             }
         }
 
-        for (const auto& child : track.children) {
-            processTrack(child);
-        }
-    };
-
-    for (const auto& t : project.tracks) {
-        processTrack(t);
-    }
-
-    // Output merged events
-    for (const auto& [timeMs, data] : timeMap)
-    {
         int finalBitmask = data.bitmask;
 
         // Clear the Normal bit since it's implicit in .osu format
@@ -178,7 +169,8 @@ juce::String ProjectSaver::GenerateHitObjectsSection(const Project& project)
         if (aSet == 0) aSet = 0;
 
         content += juce::String(sSet) + ":" +
-                   juce::String(aSet) + ":0:" +
+                   juce::String(aSet) + ":" +
+                   juce::String(data.index) + ":" +
                    juce::String(data.volume) + ":" +
                    data.filename + "\r\n";
     }
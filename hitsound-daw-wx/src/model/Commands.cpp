@@ -3,23 +3,18 @@
 
 // AddEventCommand
 
-AddEventCommand::AddEventCommand(Track* track, Event evt, std::function<void()> refreshCallback)
-    : track(track), evt(evt), refresh(refreshCallback) {}
+AddEventCommand::AddEventCommand(Project* project, Track* track, Event evt, std::function<void()> refreshCallback)
+    : project(project), track(track), evt(evt), refresh(refreshCallback) {}
 
 void AddEventCommand::Do()
 {
-    track->events.push_back(evt);
+    project->InsertEvent(*track, evt);
     refresh();
 }
 
 void AddEventCommand::Undo()
 {
-    auto it = std::find_if(track->events.rbegin(), track->events.rend(), 
-        [&](const Event& e) { return e.id == evt.id; });
-
-    if (it != track->events.rend()) {
-        track->events.erase(std::next(it).base());
-    }
+    project->EraseEvent(*track, evt);
     refresh();
 }
 
@@ -30,13 +25,13 @@ std::string AddEventCommand::GetDescription() const
 
 // AddMultipleEventsCommand
 
-AddMultipleEventsCommand::AddMultipleEventsCommand(const std::vector<Item>& items, std::function<void()> refreshCallback)
-    : items(items), refresh(refreshCallback) {}
+AddMultipleEventsCommand::AddMultipleEventsCommand(Project* project, const std::vector<Item>& items, std::function<void()> refreshCallback)
+    : project(project), items(items), refresh(refreshCallback) {}
 
 void AddMultipleEventsCommand::Do()
 {
     for (const auto& item : items) {
-        item.track->events.push_back(item.evt);
+        project->InsertEvent(*item.track, item.evt);
     }
     refresh();
 }
@@ -44,12 +39,7 @@ void AddMultipleEventsCommand::Do()
 void AddMultipleEventsCommand::Undo()
 {
     for (const auto& item : items) {
-        auto it = std::find_if(item.track->events.rbegin(), item.track->events.rend(), 
-            [&](const Event& e) { return e.id == item.evt.id; });
-
-        if (it != item.track->events.rend()) {
-            item.track->events.erase(std::next(it).base());
-        }
+        project->EraseEvent(*item.track, item.evt);
     }
     refresh();
 }
@@ -61,17 +51,13 @@ std::string AddMultipleEventsCommand::GetDescription() const
 
 // RemoveEventsCommand
 
-RemoveEventsCommand::RemoveEventsCommand(const std::vector<Item>& items, std::function<void()> refreshCallback)
-    : items(items), refresh(refreshCallback) {}
+RemoveEventsCommand::RemoveEventsCommand(Project* project, const std::vector<Item>& items, std::function<void()> refreshCallback)
+    : project(project), items(items), refresh(refreshCallback) {}
 
 void RemoveEventsCommand::Do()
 {
     for (const auto& item : items) {
-        auto it = std::find_if(item.track->events.begin(), item.track->events.end(), 
-            [&](const Event& e) { return e.id == item.evt.id; });
-        if (it != item.track->events.end()) {
-            item.track->events.erase(it);
-        }
+        project->EraseEvent(*item.track, item.evt);
     }
     refresh();
 }
@@ -79,7 +65,7 @@ void RemoveEventsCommand::Do()
 void RemoveEventsCommand::Undo()
 {
     for (const auto& item : items) {
-        item.track->events.push_back(item.evt);
+        project->InsertEvent(*item.track, item.evt);
     }
     refresh();
 }
@@ -91,22 +77,19 @@ std::string RemoveEventsCommand::GetDescription() const
 
 // MoveEventsCommand
 
-MoveEventsCommand::MoveEventsCommand(const std::vector<MoveInfo>& moves, std::function<void()> refreshCallback)
-    : moves(moves), refresh(refreshCallback) {}
+MoveEventsCommand::MoveEventsCommand(Project* project, const std::vector<MoveInfo>& moves, std::function<void()> refreshCallback)
+    : project(project), moves(moves), refresh(refreshCallback) {}
 
 void MoveEventsCommand::Do()
 {
     // First remove all original events
     for (const auto& m : moves) {
-        auto it = std::find_if(m.originalTrack->events.begin(), m.originalTrack->events.end(), 
-            [&](const Event& e) { return e.id == m.originalEvent.id; });
-        if (it != m.originalTrack->events.end()) 
-            m.originalTrack->events.erase(it);
+        project->EraseEvent(*m.originalTrack, m.originalEvent);
     }
 
     // Then add all new events
     for (const auto& m : moves) {
-        m.newTrack->events.push_back(m.newEvent);
+        project->InsertEvent(*m.newTrack, m.newEvent);
     }
 
     refresh();
@@ -116,15 +99,12 @@ void MoveEventsCommand::Undo()
 {
     // Remove new events
     for (const auto& m : moves) {
-        auto it = std::find_if(m.newTrack->events.begin(), m.newTrack->events.end(), 
-            [&](const Event& e) { return e.id == m.newEvent.id; });
-        if (it != m.newTrack->events.end()) 
-            m.newTrack->events.erase(it);
+        project->EraseEvent(*m.newTrack, m.newEvent);
     }
 
     // Restore original events
     for (const auto& m : moves) {
-        m.originalTrack->events.push_back(m.originalEvent);
+        project->InsertEvent(*m.originalTrack, m.originalEvent);
     }
     refresh();
 }
@@ -136,16 +116,16 @@ std::string MoveEventsCommand::GetDescription() const
 
 // PasteEventsCommand
 
-PasteEventsCommand::PasteEventsCommand(const std::vector<PasteItem>& items, 
+PasteEventsCommand::PasteEventsCommand(Project* project, const std::vector<PasteItem>& items, 
     std::function<void(const std::vector<Track*>&)> selectionCallback, 
     std::function<void()> refreshCallback)
-    : items(items), select(selectionCallback), refresh(refreshCallback) {}
+    : project(project), items(items), select(selectionCallback), refresh(refreshCallback) {}
 
 void PasteEventsCommand::Do()
 {
     std::vector<Track*> affected;
     for (const auto& item : items) {
-        item.track->events.push_back(item.evt);
+        project->InsertEvent(*item.track, item.evt);
         affected.push_back(item.track);
     }
 
@@ -157,11 +137,7 @@ void PasteEventsCommand::Do()
 void PasteEventsCommand::Undo()
 {
     for (const auto& item : items) {
-        auto it = std::find_if(item.track->events.rbegin(), item.track->events.rend(), 
-            [&](const Event& e) { return e.id == item.evt.id; });
-        if (it != item.track->events.rend()) {
-            item.track->events.erase(std::next(it).base());
-        }
+        project->EraseEvent(*item.track, item.evt);
     }
     refresh();
 }
@@ -8,13 +8,14 @@
 class AddEventCommand : public Command
 {
 public:
-    AddEventCommand(Track* track, Event evt, std::function<void()> refreshCallback);
+    AddEventCommand(Project* project, Track* track, Event evt, std::function<void()> refreshCallback);
 
     void Do() override;
     void Undo() override;
     std::string GetDescription() const override;
 
 private:
+    Project* project;
     Track* track;
     Event evt;
     std::function<void()> refresh;
@@ -29,13 +30,14 @@ public:
         Event evt;
     };
 
-    AddMultipleEventsCommand(const std::vector<Item>& items, std::function<void()> refreshCallback);
+    AddMultipleEventsCommand(Project* project, const std::vector<Item>& items, std::function<void()> refreshCallback);
 
     void Do() override;
     void Undo() override;
     std::string GetDescription() const override;
 
 private:
+    Project* project;
     std::vector<Item> items;
     std::function<void()> refresh;
 };
@@ -48,13 +50,14 @@ public:
         Event evt;
     };
 
-    RemoveEventsCommand(const std::vector<Item>& items, std::function<void()> refreshCallback);
+    RemoveEventsCommand(Project* project, const std::vector<Item>& items, std::function<void()> refreshCallback);
 
     void Do() override;
     void Undo() override;
     std::string GetDescription() const override;
 
 private:
+    Project* project;
     std::vector<Item> items;
     std::function<void()> refresh;
 };
@@ -69,13 +72,14 @@ public:
         Event newEvent;
     };
 
-    MoveEventsCommand(const std::vector<MoveInfo>& moves, std::function<void()> refreshCallback);
+    MoveEventsCommand(Project* project, const std::vector<MoveInfo>& moves, std::function<void()> refreshCallback);
 
     void Do() override;
     void Undo() override;
     std::string GetDescription() const override;
 
 private:
+    Project* project;
     std::vector<MoveInfo> moves;
     std::function<void()> refresh;
 };
@@ -88,7 +92,7 @@ public:
         Event evt;
     };
 
-    PasteEventsCommand(const std::vector<PasteItem>& items, 
+    PasteEventsCommand(Project* project, const std::vector<PasteItem>& items, 
         std::function<void(const std::vector<Track*>&)> selectionCallback, 
         std::function<void()> refreshCallback);
 
@@ -97,6 +101,7 @@ public:
     std::string GetDescription() const override;
 
 private:
+    Project* project;
     std::vector<PasteItem> items;
     std::function<void(const std::vector<Track*>&)> select;
     std::function<void()> refresh;
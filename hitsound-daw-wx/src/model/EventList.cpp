@@ -0,0 +1,103 @@
+#include "EventList.h"
+#include <algorithm>
+
+namespace
+{
+    constexpr double boundSlackMs = 1e-6;
+
+    uint8_t ToPercent(double volume)
+    {
+        return (uint8_t)std::clamp(std::lround(volume * 100.0), 0L, 255L);
+    }
+}
+
+size_t EventList::LowerBound(double time) const
+{
+    // Event times are whole ms, so "at or after time" is "at or after ceil(time)".
+    // The slack keeps an event's own time (0.001 * 1000.0 is 1.0000000000000002)
+    // on its millisecond, as ToMs would round it.
+    const auto ms = (int32_t)std::ceil(time * 1000.0 - boundSlackMs);
+    return std::lower_bound(timesMs.begin(), timesMs.end(), ms) - timesMs.begin();
+}
+
+size_t EventList::UpperBound(double time) const
+{
+    const auto ms = (int32_t)std::floor(time * 1000.0 + boundSlackMs);
+    return std::upper_bound(timesMs.begin(), timesMs.end(), ms) - timesMs.begin();
+}
+
+size_t EventList::Insert(const Event& evt)
+{
+    const int32_t ms = ToMs(evt.time);
+    const size_t index = std::upper_bound(timesMs.begin(), timesMs.end(), ms) - timesMs.begin();
+
+    timesMs.insert(timesMs.begin() + index, ms);
+    volumes.insert(volumes.begin() + index, ToPercent(evt.volume));
+    flags.insert(flags.begin() + index, (uint8_t)evt.validationState);
+    ids.insert(ids.begin() + index, evt.id);
+    return index;
+}
+
+int EventList::Find(uint64_t id, double time) const
+{
+    const int32_t ms = ToMs(time);
+
+    for (size_t i = std::lower_bound(timesMs.begin(), timesMs.end(), ms) - timesMs.begin();
+         i < timesMs.size() && timesMs[i] == ms; ++i)
+        if (ids[i] == id) return (int)i;
+
+    for (size_t i = 0; i < ids.size(); ++i)
+        if (ids[i] == id) return (int)i;
+
+    return -1;
+}
+
+bool EventList::Erase(const Event& evt)
+{
+    const int index = Find(evt);
+    if (index < 0) return false;
+
+    timesMs.erase(timesMs.begin() + index);
+    volumes.erase(volumes.begin() + index);
+    flags.erase(flags.begin() + index);
+    ids.erase(ids.begin() + index);
+    return true;
+}
+
+bool EventList::HasEventNear(double time, double tolerance) const
+{
+    const int32_t ms = ToMs(time);
+    const double toleranceMs = std::max(1.0, tolerance * 1000.0);
+
+    // The first event strictly after ms - toleranceMs is the only candidate
+    const auto first = (int32_t)std::floor(ms - toleranceMs) + 1;
+    auto it = std::lower_bound(timesMs.begin(), timesMs.end(), first);
+    return it != timesMs.end() && *it < ms + toleranceMs;
+}
+
+void EventList::Assign(std::vector<Event> events)
+{
+    for (auto& e : events)
+        e.time = ToMs(e.time) / 1000.0;
+
+    std::stable_sort(events.begin(), events.end(),
+        [](const Event& a, const Event& b) { return a.time < b.time; });
+
+    timesMs.clear();
+    volumes.clear();
+    flags.clear();
+    ids.clear();
+
+    timesMs.reserve(events.size());
+    volumes.reserve(events.size());
+    flags.reserve(events.size());
+    ids.reserve(events.size());
+
+    for (const auto& e : events)
+    {
+        timesMs.push_back(ToMs(e.time));
+        volumes.push_back(ToPercent(e.volume));
+        flags.push_back((uint8_t)e.validationState);
+        ids.push_back(e.id);
+    }
+}
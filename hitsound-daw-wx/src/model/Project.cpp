@@ -0,0 +1,148 @@
+#include "Project.h"
+#include <algorithm>
+
+namespace
+{
+    bool Contains(const Track& track, const Track* other)
+    {
+        if (&track == other) return true;
+        for (const auto& child : track.children)
+            if (Contains(child, other)) return true;
+        return false;
+    }
+}
+
+Track* Project::FindTrack(uint64_t trackId)
+{
+    if (!index.tracksValid) BuildTrackIndex();
+
+    auto it = index.tracks.find(trackId);
+    return it != index.tracks.end() ? it->second : nullptr;
+}
+
+std::optional<Event> Project::FindEvent(uint64_t eventId, Track** track)
+{
+    if (!index.valid) BuildIndex();
+
+    auto it = index.events.find(eventId);
+    if (it == index.events.end()) return std::nullopt;
+
+    const Track* owner = it->second.track;
+    int i = owner->events.Find(eventId, it->second.time);
+    if (i < 0) return std::nullopt;
+
+    if (track) *track = FindTrack(owner->id);
+    return owner->events[i];
+}
+
+void Project::InsertEvent(Track& track, const Event& evt)
+{
+    size_t i = track.events.Insert(evt);
+    if (!index.valid) return;
+
+    index.events[evt.id] = { &track, evt.time };
+    AddToTimeIndex(track, i);
+    index.changes.timesMs.push_back(track.events.TimeMs(i));
+}
+
+bool Project::EraseEvent(Track& track, const Event& evt)
+{
+    if (!track.events.Erase(evt)) return false;
+    if (!index.valid) return true;
+
+    index.events.erase(evt.id);
+
+    const int32_t timeMs = EventList::ToMs(evt.time);
+    index.changes.timesMs.push_back(timeMs);
+
+    auto slot = index.times.find(timeMs);
+    if (slot != index.times.end())
+    {
+        auto& refs = slot->second;
+        refs.erase(std::remove_if(refs.begin(), refs.end(),
+            [&evt](const EventRef& ref) { return ref.eventId == evt.id; }), refs.end());
+        if (refs.empty()) index.times.erase(slot);
+    }
+    return true;
+}
+
+const Project::TimeIndex& Project::GetTimeIndex() const
+{
+    if (!index.valid) BuildIndex();
+    return index.times;
+}
+
+const std::vector<Project::EventRef>* Project::EventsAt(int32_t timeMs) const
+{
+    const auto& times = GetTimeIndex();
+    auto it = times.find(timeMs);
+    return it != times.end() ? &it->second : nullptr;
+}
+
+bool Project::HasHitnormalAt(double time) const
+{
+    const auto* refs = EventsAt(EventList::ToMs(time));
+    if (!refs) return false;
+
+    // The top-level track's type decides, whatever its children are set to
+    for (const auto& t : tracks)
+    {
+        if (t.sampleType != SampleType::HitNormal) continue;
+
+        for (const auto& ref : *refs)
+            if (Contains(t, ref.track)) return true;
+    }
+    return false;
+}
+
+Project::Changes Project::TakeChanges()
+{
+    if (!index.valid) BuildIndex();
+
+    Changes changes = std::move(index.changes);
+    index.changes = { false, {} };
+    return changes;
+}
+
+void Project::AddToTimeIndex(const Track& track, size_t eventIndex) const
+{
+    index.times[track.events.TimeMs(eventIndex)].push_back({ &track, track.events.Id(eventIndex), track.events.Volume(eventIndex) });
+}
+
+void Project::BuildIndex() const
+{
+    index.events.clear();
+    index.times.clear();
+    index.changes = {};
+
+    auto add = [this](const Track& t, auto& self) -> void {
+        for (size_t i = 0; i < t.events.size(); ++i)
+        {
+            index.events[t.events.Id(i)] = { &t, t.events.Time(i) };
+            AddToTimeIndex(t, i);
+        }
+        for (const auto& child : t.children)
+            self(child, self);
+    };
+
+    for (const auto& t : tracks)
+        add(t, add);
+
+    index.valid = true;
+}
+
+void Project::BuildTrackIndex()
+{
+    index.tracks.clear();
+
+    auto add = [this](Track& t, auto& self) -> void {
+        index.tracks[t.id] = &t;
+        for (auto& child : t.children)
+            self(child, self);
+    };
+
+    for (auto& t : tracks)
+        add(t, add);
+
+    index.tracksValid = true;
+}
@@ -1,4 +1,7 @@
 #pragma once
+#include <map>
+#include <optional>
+#include <unordered_map>
 #include <vector>
 #include "Track.h"
 
@@ -10,6 +13,7 @@ struct Project
         double time;       // Milliseconds from start
         double beatLength; // Milliseconds per beat (BPM = 60000 / beatLength)
         int sampleSet;     // 0=auto, 1=normal, 2=soft, 3=drum
+        int sampleIndex;   // Custom sample index (0 = built-in samples)
         double volume;     // 0-100
         bool uninherited;  // True = red line (BPM), false = green line (SV)
     };
@@ -30,4 +34,81 @@ struct Project
     std::string audioFilename;
     std::string projectDirectory;
     std::string projectFilePath;
+
+    // Id lookups through hash indexes. They are built on first use and kept
+    // current by InsertEvent/EraseEvent, which the edit commands go through.
+    // Adding, removing or reordering tracks moves Track objects, so call
+    // InvalidateIndex() afterwards.
+    Track* FindTrack(uint64_t trackId);
+
+    // A copy of the event with this id. Sets track to its owner when given.
+    std::optional<Event> FindEvent(uint64_t eventId, Track** track = nullptr);
+
+    void InsertEvent(Track& track, const Event& evt);
+    bool EraseEvent(Track& track, const Event& evt);
+
+    void InvalidateIndex() { index.valid = false; index.tracksValid = false; }
+
+    // Every event by millisecond across all tracks, kept alongside the id
+    // indexes. Validation, export, playback compilation and auto-hitnormal
+    // placement all read this instead of walking the tracks; an edit only
+    // touches the slots of the events it inserts or erases. Edits go through
+    // FindTrack(ref.track->id) for a mutable track.
+    struct EventRef {
+        const Track* track;
+        uint64_t eventId;
+        double volume;
+    };
+    using TimeIndex = std::map<int32_t, std::vector<EventRef>>;
+
+    const TimeIndex& GetTimeIndex() const;
+
+    // The events in this millisecond, or nullptr if there are none
+    const std::vector<EventRef>* EventsAt(int32_t timeMs) const;
+
+    // True if a hitnormal track (a top-level HitNormal track, or any of its
+    // children) has an event in the same millisecond
+    bool HasHitnormalAt(double time) const;
+
+    // What changed since the last call, for incremental validation: the
+    // milliseconds InsertEvent/EraseEvent touched, or everything once the
+    // index was rebuilt or MarkAllChanged() was called (e.g. a bank edit)
+    struct Changes {
+        bool all = true;
+        std::vector<int32_t> timesMs;
+    };
+    Changes TakeChanges();
+
+    void MarkAllChanged() { index.changes.all = true; }
+
+private:
+    // The owner plus the time, so the event is one binary search away
+    struct EventLocation {
+        const Track* track;
+        double time;
+    };
+
+    // Points into the project it was built for, so copies start out unbuilt.
+    // The event and time indexes are read through const methods, so they are
+    // built from the const tracks and only hold const pointers. The mutable
+    // track pointers are built separately, by FindTrack.
+    struct Index {
+        bool valid = false;
+        std::unordered_map<uint64_t, EventLocation> events;
+        TimeIndex times;
+        Changes changes;
+
+        bool tracksValid = false;
+        std::unordered_map<uint64_t, Track*> tracks;
+
+        Index() = default;
+        Index(const Index&) {}
+        Index& operator=(const Index&) { valid = false; tracksValid = false; return *this; }
+    };
+
+    mutable Index index;
+
+    void BuildIndex() const;
+    void BuildTrackIndex();
+    void AddToTimeIndex(const Track& track, size_t eventIndex) const;
 };
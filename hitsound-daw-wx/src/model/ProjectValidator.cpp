@@ -1,40 +1,10 @@
 #include "ProjectValidator.h"
-#include <map>
-#include <cmath>
-#include <functional>
+#include <algorithm>
 
-std::vector<ProjectValidator::ValidationError> ProjectValidator::Validate(Project& project)
+namespace
 {
-    std::vector<ValidationError> errors;
-
-    // Group events by timestamp (rounded to ms) for conflict detection
-    struct TimeSlice {
-        std::vector<Event*> events;
-        std::vector<Track*> tracks;
-    };
-    std::map<long long, TimeSlice> slices;
-
-    // Recursively collect all events including from child tracks
-    std::function<void(Track&)> collectEvents = [&](Track& track) {
-        for (auto& event : track.events)
-        {
-            long long timeMs = (long long)(event.time * 1000.0 + 0.5);
-            slices[timeMs].events.push_back(&event);
-            slices[timeMs].tracks.push_back(&track);
-        }
-        for (auto& child : track.children)
-        {
-            collectEvents(child);
-        }
-    };
-
-    for (auto& track : project.tracks)
-    {
-        collectEvents(track);
-    }
-
-    // Check each time slice for bank conflicts
-    for (auto& [time, slice] : slices)
+    // Checks the events of one millisecond for bank conflicts and updates their ValidationState
+    void ValidateSlot(Project& project, int32_t time, const std::vector<Project::EventRef>& refs, std::vector<ProjectValidator::ValidationError>& errors)
     {
         SampleSet additionBank = SampleSet::Normal;
         bool additionBankSet = false;
@@ -45,9 +15,9 @@ std::vector<ProjectValidator::ValidationError> ProjectValidator::Validate(Projec
         bool conflict = false;
         std::string conflictingBankName = "";
 
-        for (size_t i = 0; i < slice.events.size(); ++i)
+        for (const auto& ref : refs)
         {
-            Track* t = slice.tracks[i];
+            const Track* t = ref.track;
 
             bool isAddition = (t->sampleType == SampleType::HitWhistle ||
                                t->sampleType == SampleType::HitFinish ||
@@ -86,20 +56,54 @@ std::vector<ProjectValidator::ValidationError> ProjectValidator::Validate(Projec
         {
             std::string bankName = (additionBank == SampleSet::Normal) ? "Normal" : (additionBank == SampleSet::Soft ? "Soft" : "Drum");
             errors.push_back({ (double)time / 1000.0, "Conflicting addition banks: " + bankName + " vs " + conflictingBankName });
-
-            for (auto* e : slice.events)
-            {
-                e->validationState = ValidationState::Invalid;
-            }
         }
-        else
+
+        const auto state = conflict ? ValidationState::Invalid : ValidationState::Valid;
+        for (const auto& ref : refs)
         {
-            for (auto* e : slice.events)
-            {
-                e->validationState = ValidationState::Valid;
-            }
+            Track* track = project.FindTrack(ref.track->id);
+            if (!track) continue;
+
+            int i = track->events.Find(ref.eventId, time / 1000.0);
+            if (i >= 0) track->events.SetValidation((size_t)i, state);
         }
     }
+}
+
+std::vector<ProjectValidator::ValidationError> ProjectValidator::Validate(Project& project)
+{
+    std::vector<ValidationError> errors;
+
+    // A full pass covers whatever edits were pending
+    project.TakeChanges();
+
+    for (const auto& [time, refs] : project.GetTimeIndex())
+        ValidateSlot(project, time, refs, errors);
 
     return errors;
 }
+
+std::vector<ProjectValidator::ValidationError> ProjectValidator::Validate(Project& project, std::vector<int32_t> timesMs)
+{
+    std::vector<ValidationError> errors;
+
+    std::sort(timesMs.begin(), timesMs.end());
+    timesMs.erase(std::unique(timesMs.begin(), timesMs.end()), timesMs.end());
+
+    // Times whose last event was removed have nothing left to check
+    for (int32_t time : timesMs)
+        if (const auto* refs = project.EventsAt(time))
+            ValidateSlot(project, time, *refs, errors);
+
+    return errors;
+}
+
+void ProjectValidator::ValidateChanges(Project& project)
+{
+    auto changes = project.TakeChanges();
+
+    if (changes.all)
+        Validate(project);
+    else
+        Validate(project, std::move(changes.timesMs));
+}
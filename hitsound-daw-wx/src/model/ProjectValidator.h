@@ -13,5 +13,13 @@ public:
     };
 
     // Validates events and updates their ValidationState. Returns any errors found.
+    // Full pass over the project, for load and save.
     static std::vector<ValidationError> Validate(Project& project);
+
+    // Only the events at the given milliseconds. Returns the errors among them.
+    static std::vector<ValidationError> Validate(Project& project, std::vector<int32_t> timesMs);
+
+    // After an edit: revalidates the milliseconds the project's edits touched
+    // since the last pass (see Project::TakeChanges), or everything if needed
+    static void ValidateChanges(Project& project);
 };
@@ -3,26 +3,12 @@
 #include <vector>
 #include <optional>
 #include <atomic>
+#include "EventList.h"
 #include "SampleTypes.h"
 
-enum class ValidationState {
-    Valid,
-    Invalid,
-    Warning
-};
-
-// Global ID generators for undo/redo matching
-inline std::atomic<uint64_t> g_nextEventId{1};
+// Global ID generator for undo/redo matching
 inline std::atomic<uint64_t> g_nextTrackId{1};
 
-struct Event
-{
-    uint64_t id = g_nextEventId++;
-    double time;  // In seconds
-    double volume = 1.0;
-    ValidationState validationState = ValidationState::Valid;
-};
-
 // Represents a sample layer for grouping tracks
 struct SampleLayer
 {
@@ -38,6 +24,7 @@ struct Track
     // Sample metadata
     SampleSet sampleSet = SampleSet::Normal;
     SampleType sampleType = SampleType::HitNormal;
+    int sampleIndex = 0;  // osu! custom sample index (0 = built-in sample)
     std::string customFilename;
 
     // Composite layers (for groupings that play multiple samples)
@@ -48,7 +35,9 @@ struct Track
     bool mute = false;
     bool solo = false;
 
-    std::vector<Event> events;
+    // Sorted by time. Add and remove events through Project::InsertEvent /
+    // EraseEvent so its id index stays current.
+    EventList events;
 
     // Hierarchy
     std::vector<Track> children;
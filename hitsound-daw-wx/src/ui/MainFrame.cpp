@@ -11,6 +11,10 @@
 #include "ValidationErrorsDialog.h"
 #include "ValidationErrorsDialog.h"
 #include <wx/filename.h>
+#include <wx/stdpaths.h>
+#include <wx/config.h>
+#include <wx/choicdlg.h>
+#include <wx/progdlg.h>
 #include "../model/HotkeyManager.h"
 #include "SettingsDialog.h"
 
@@ -26,7 +30,27 @@ MainFrame::MainFrame()
     : wxFrame(nullptr, wxID_ANY, "Hitsound DAW (wx + JUCE)", wxDefaultPosition, wxSize(1200, 800))
     , playbackTimer(this, ID_PLAYBACK_TIMER)
 {
-    audioEngine.initialize();
+    // Samples are resampled to the device rate in the background; recompile once they're ready
+    audioEngine.GetSampleRegistry().onSamplesRendered = [this]() {
+        CallAfter([this]() { audioEngine.NotifyTracksChanged(); });
+    };
+
+    // The song's waveform is built (or loaded from the cache) in the background and drawn as it fills in
+    wxString waveformCacheDir = wxStandardPaths::Get().GetUserDataDir() + wxFileName::GetPathSeparator() + "WaveformCache";
+    audioEngine.SetWaveformCacheDirectory(juce::File(waveformCacheDir.ToStdString()));
+    audioEngine.OnWaveformUpdated = [this]() {
+        CallAfter([this]() { timelineView->SetWaveform(audioEngine.GetWaveform(), audioEngine.GetDuration()); });
+    };
+
+    // Saved output device and latency trim (Settings -> Audio); empty means the defaults
+    AudioDeviceSettings deviceSettings;
+    deviceSettings.deviceType = juce::String::fromUTF8(wxConfigBase::Get()->Read("Audio/DeviceType", "").utf8_str());
+    deviceSettings.outputDevice = juce::String::fromUTF8(wxConfigBase::Get()->Read("Audio/OutputDevice", "").utf8_str());
+    deviceSettings.sampleRate = wxConfigBase::Get()->ReadDouble("Audio/SampleRate", 0.0);
+    deviceSettings.bufferSize = (int)wxConfigBase::Get()->ReadLong("Audio/BufferSize", 0);
+    audioEngine.SetLatencyTrim(wxConfigBase::Get()->ReadLong("Audio/LatencyTrimMs", 0) / 1000.0);
+    
+    audioEngine.initialize(deviceSettings);
     
     
     
@@ -55,6 +79,14 @@ MainFrame::MainFrame()
         wxMessageBox("Could not find 'Resources' folder containing samples.", "Warning", wxICON_WARNING);
     }
     
+    // Skin hitsounds sit between the beatmap's own samples and the built-in ones
+    wxString skinFolder = wxConfigBase::Get()->Read("Samples/SkinFolder", "");
+    if (!skinFolder.IsEmpty())
+        audioEngine.GetSampleRegistry().setSkinDirectory(juce::File(skinFolder.ToStdString()));
+    
+    long cacheBudgetMB = wxConfigBase::Get()->ReadLong("Samples/CacheBudgetMB", (long)(SampleRegistry::defaultMemoryBudget >> 20));
+    audioEngine.GetSampleRegistry().setMemoryBudget((size_t)cacheBudgetMB << 20);
+    
     // Initialize Hotkey Defaults
     std::vector<HotkeyManager::CommandInfo> defaults = {
         { wxID_OPEN, "Open File", "Open an .osu file", wxAcceleratorEntry(wxACCEL_CTRL, 'O', wxID_OPEN) },
@@ -91,6 +123,7 @@ MainFrame::MainFrame()
     
     
     trackList->SetTimelineView(timelineView);
+    trackList->SetAudioEngine(&audioEngine);
     
     
     transportPanel = new TransportPanel(this, &audioEngine, timelineView);
@@ -192,6 +225,8 @@ void MainFrame::BuildMenu()
     fileMenu->AppendSeparator();
     fileMenu->Append(ID_SAVE, "&Save\tCtrl+S", "Save the project");
     fileMenu->Append(ID_SAVE_AS, "Save &As...\tCtrl+Shift+S", "Save the project as a new file");
+    fileMenu->Append(ID_EXPORT_AUDIO, "&Export Audio...", "Render the song and hitsounds to a WAV or FLAC file");
+    fileMenu->Append(ID_EXPORT_STEMS, "Export S&tems...", "Render one hitsound file per track");
     fileMenu->AppendSeparator();
     fileMenu->Append(ID_SETTINGS, "Settings...", "Configure application settings");
     fileMenu->AppendSeparator();
@@ -247,6 +282,8 @@ void MainFrame::BuildMenu()
     Bind(wxEVT_MENU, &MainFrame::OnCreatePreset, this, ID_CREATE_PRESET);
     Bind(wxEVT_MENU, &MainFrame::OnSave, this, ID_SAVE);
     Bind(wxEVT_MENU, &MainFrame::OnSaveAs, this, ID_SAVE_AS);
+    Bind(wxEVT_MENU, &MainFrame::OnExportAudio, this, ID_EXPORT_AUDIO);
+    Bind(wxEVT_MENU, &MainFrame::OnExportStems, this, ID_EXPORT_STEMS);
     Bind(wxEVT_MENU, &MainFrame::OnSettings, this, ID_SETTINGS);
 }
 
@@ -259,7 +296,14 @@ void MainFrame::OnOpen(wxCommandEvent& evt)
         return;
         
     juce::File file(openFileDialog.GetPath().ToStdString());
-    project = OsuParser::parse(file);
+    juce::String parseError;
+    Project opened = OsuParser::parse(file, &parseError);
+    if (parseError.isNotEmpty())
+    {
+        wxMessageBox(parseError.toStdString(), "Could not open file", wxICON_ERROR);
+        return;
+    }
+    project = opened;
     
     
     ProjectValidator::Validate(project);
@@ -268,20 +312,16 @@ void MainFrame::OnOpen(wxCommandEvent& evt)
     timelineView->SetProject(&project);
     
     
-    audioEngine.SetTracks(&project.tracks);
+    // Samples first, so the schedule is never compiled against the previous beatmap's ids
+    audioEngine.LoadBeatmapSamples(project);
+    audioEngine.SetProject(&project);
     
     
     juce::File audioFile = file.getParentDirectory().getChildFile(juce::String(project.audioFilename));
     if (audioFile.existsAsFile())
     {
         audioEngine.LoadMasterTrack(audioFile.getFullPathName().toStdString());
-        
-        
-        
-        int w = 4000; 
-        auto peaks = audioEngine.GetWaveform(w); 
-        double duration = audioEngine.GetDuration();
-        timelineView->SetWaveform(peaks, duration);
+        timelineView->SetWaveform(audioEngine.GetWaveform(), audioEngine.GetDuration());
     }
     
     
@@ -341,15 +381,26 @@ void MainFrame::OnOpenFolder(wxCommandEvent& evt)
     std::string refFilename = dlg.GetSelectedFilename();
     juce::File referenceFile = dir.getChildFile(refFilename);
 
+    juce::String parseError;
+    
     if (dlg.GetSelectedAction() == ProjectSetupDialog::Action::OpenExisting)
     {
-        project = OsuParser::parse(referenceFile);
+        Project opened = OsuParser::parse(referenceFile, &parseError);
+        if (parseError.isNotEmpty())
+        {
+            wxMessageBox(parseError.toStdString(), "Could not open file", wxICON_ERROR);
+            return;
+        }
+        project = opened;
     }
     else
     {
-        
-        
-        Project refProject = OsuParser::parse(referenceFile);
+        Project refProject = OsuParser::parse(referenceFile, &parseError);
+        if (parseError.isNotEmpty())
+        {
+            wxMessageBox(parseError.toStdString(), "Could not open file", wxICON_ERROR);
+            return;
+        }
         
         std::string newFilename = refProject.artist + " - " + refProject.title + " (" + refProject.creator + ") [Hitsounds].osu";
         
@@ -364,7 +415,13 @@ void MainFrame::OnOpenFolder(wxCommandEvent& evt)
 
         if (OsuParser::CreateHitsoundDiff(referenceFile, targetFile))
         {
-            project = OsuParser::parse(targetFile);
+            Project created = OsuParser::parse(targetFile, &parseError);
+            if (parseError.isNotEmpty())
+            {
+                wxMessageBox(parseError.toStdString(), "Could not open file", wxICON_ERROR);
+                return;
+            }
+            project = created;
         }
         else
         {
@@ -379,15 +436,15 @@ void MainFrame::OnOpenFolder(wxCommandEvent& evt)
     timelineView->SetProject(&project);
     
     
-    audioEngine.SetTracks(&project.tracks);
+    // Samples first, so the schedule is never compiled against the previous beatmap's ids
+    audioEngine.LoadBeatmapSamples(project);
+    audioEngine.SetProject(&project);
     
     juce::File audioFile = dir.getChildFile(juce::String(project.audioFilename));
     if (audioFile.existsAsFile())
     {
         audioEngine.LoadMasterTrack(audioFile.getFullPathName().toStdString());
-        auto peaks = audioEngine.GetWaveform(4000);
-        double duration = audioEngine.GetDuration();
-        timelineView->SetWaveform(peaks, duration);
+        timelineView->SetWaveform(audioEngine.GetWaveform(), audioEngine.GetDuration());
     }
 
     
@@ -414,6 +471,10 @@ void MainFrame::OnOpenFolder(wxCommandEvent& evt)
 
 void MainFrame::OnTimer(wxTimerEvent& evt)
 {
+    transportPanel->UpdateLoadProgress(audioEngine.GetMasterTrackLoadProgress());
+    transportPanel->UpdatePerformance(audioEngine.GetPerformanceStats());
+    trackList->UpdateMeters();
+    
     if (audioEngine.IsPlaying())
     {
         double pos = audioEngine.GetPosition();
@@ -580,6 +641,82 @@ void MainFrame::OnSaveAs(wxCommandEvent& evt)
     PerformSave(file);
 }
 
+void MainFrame::OnExportAudio(wxCommandEvent& evt)
+{
+    wxFileDialog exportDialog(this, _("Export Audio"), "", "",
+                              "WAV files (*.wav)|*.wav|FLAC files (*.flac)|*.flac", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+
+    if (exportDialog.ShowModal() == wxID_CANCEL)
+        return;
+
+    wxArrayString contentChoices;
+    contentChoices.Add("Song and hitsounds");
+    contentChoices.Add("Hitsounds only");
+
+    wxSingleChoiceDialog contentDialog(this, "What should be exported?", "Export Audio", contentChoices);
+    if (contentDialog.ShowModal() == wxID_CANCEL)
+        return;
+
+    juce::File file(exportDialog.GetPath().ToStdString());
+    auto format = exportDialog.GetFilterIndex() == 1 ? OfflineRenderer::Format::Flac : OfflineRenderer::Format::Wav;
+    auto content = contentDialog.GetSelection() == 1 ? OfflineRenderer::Content::HitsoundsOnly : OfflineRenderer::Content::FullMix;
+
+    if (!file.hasFileExtension("wav;flac"))
+        file = file.withFileExtension(format == OfflineRenderer::Format::Flac ? ".flac" : ".wav");
+
+    juce::Result result = juce::Result::ok();
+    bool cancelled = false;
+
+    {
+        wxProgressDialog progressDialog("Export Audio", "Rendering " + wxString(file.getFileName().toStdString()) + "...",
+                                        1000, this, wxPD_APP_MODAL | wxPD_CAN_ABORT | wxPD_ELAPSED_TIME | wxPD_REMAINING_TIME);
+
+        result = audioEngine.ExportAudio(project, file, format, content, [&](double progress) {
+            return progressDialog.Update((int)(progress * 1000.0));
+        });
+
+        cancelled = progressDialog.WasCancelled();
+    }
+
+    if (result.failed() && !cancelled)
+        wxMessageBox("Export failed: " + wxString(result.getErrorMessage().toStdString()), "Error", wxICON_ERROR);
+}
+
+void MainFrame::OnExportStems(wxCommandEvent& evt)
+{
+    wxDirDialog dirDialog(this, "Choose a folder for the stems", "", wxDD_DEFAULT_STYLE);
+    if (dirDialog.ShowModal() == wxID_CANCEL)
+        return;
+
+    wxArrayString formatChoices;
+    formatChoices.Add("WAV");
+    formatChoices.Add("FLAC");
+
+    wxSingleChoiceDialog formatDialog(this, "Stem file format:", "Export Stems", formatChoices);
+    if (formatDialog.ShowModal() == wxID_CANCEL)
+        return;
+
+    juce::File directory(dirDialog.GetPath().ToStdString());
+    auto format = formatDialog.GetSelection() == 1 ? OfflineRenderer::Format::Flac : OfflineRenderer::Format::Wav;
+
+    juce::Result result = juce::Result::ok();
+    bool cancelled = false;
+
+    {
+        wxProgressDialog progressDialog("Export Stems", "Rendering stems...", 1000, this,
+                                        wxPD_APP_MODAL | wxPD_CAN_ABORT | wxPD_ELAPSED_TIME | wxPD_REMAINING_TIME);
+
+        result = audioEngine.ExportStems(project, directory, format, [&](double progress) {
+            return progressDialog.Update((int)(progress * 1000.0));
+        });
+
+        cancelled = progressDialog.WasCancelled();
+    }
+
+    if (result.failed() && !cancelled)
+        wxMessageBox("Export failed: " + wxString(result.getErrorMessage().toStdString()), "Error", wxICON_ERROR);
+}
+
 bool MainFrame::PerformSave(const juce::File& file)
 {
     
@@ -657,6 +794,32 @@ void MainFrame::OnClose(wxCloseEvent& evt)
 
 void MainFrame::OnSettings(wxCommandEvent& evt)
 {
-    SettingsDialog dlg(this);
+    auto& registry = audioEngine.GetSampleRegistry();
+    auto stats = registry.getCacheStats();
+    
+    SettingsDialog dlg(this, &audioEngine);
+    dlg.SetLatencyTrimMs((int)std::lround(audioEngine.GetLatencyTrim() * 1000.0));
+    dlg.SetSkinFolder(wxConfigBase::Get()->Read("Samples/SkinFolder", ""));
+    dlg.SetSampleCacheBudget((int)(stats.memoryBudget >> 20));
+    dlg.SetSampleCacheStats(wxString::Format("%d samples (%d shared), %.1f MB in use\nHit rate %.0f%%, %d evicted",
+                                             stats.numSamples, stats.numShared, stats.memoryUsed / (1024.0 * 1024.0),
+                                             stats.getHitRate() * 100.0, stats.numEvicted));
     dlg.ShowModal();
+    
+    // The device itself was switched while the dialog was open
+    AudioDeviceSettings device = audioEngine.GetDeviceSettings();
+    wxConfigBase::Get()->Write("Audio/DeviceType", wxString::FromUTF8(device.deviceType.toRawUTF8()));
+    wxConfigBase::Get()->Write("Audio/OutputDevice", wxString::FromUTF8(device.outputDevice.toRawUTF8()));
+    wxConfigBase::Get()->Write("Audio/SampleRate", device.sampleRate);
+    wxConfigBase::Get()->Write("Audio/BufferSize", (long)device.bufferSize);
+    
+    wxConfigBase::Get()->Write("Audio/LatencyTrimMs", (long)dlg.GetLatencyTrimMs());
+    audioEngine.SetLatencyTrim(dlg.GetLatencyTrimMs() / 1000.0);
+    
+    wxString skinFolder = dlg.GetSkinFolder();
+    wxConfigBase::Get()->Write("Samples/SkinFolder", skinFolder);
+    registry.setSkinDirectory(skinFolder.IsEmpty() ? juce::File() : juce::File(skinFolder.ToStdString()));
+    
+    wxConfigBase::Get()->Write("Samples/CacheBudgetMB", (long)dlg.GetSampleCacheBudget());
+    registry.setMemoryBudget((size_t)dlg.GetSampleCacheBudget() << 20);
 }
@@ -19,6 +19,8 @@ public:
         ID_SAVE,
         ID_SAVE_AS,
         ID_SETTINGS,
+        ID_EXPORT_AUDIO,
+        ID_EXPORT_STEMS,
         ID_PLAYBACK_TIMER = 10002,
         
         
@@ -52,6 +54,8 @@ private:
     void OnOpenFolder(wxCommandEvent& evt);
     void OnSave(wxCommandEvent& evt);
     void OnSaveAs(wxCommandEvent& evt);
+    void OnExportAudio(wxCommandEvent& evt);
+    void OnExportStems(wxCommandEvent& evt);
     void OnScrollTimeline(wxScrollWinEvent& evt);
     void OnTimer(wxTimerEvent& evt);
     void OnLoadPreset(wxCommandEvent& evt);
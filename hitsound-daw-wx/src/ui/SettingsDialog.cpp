@@ -2,12 +2,15 @@
 #include "../model/HotkeyManager.h"
 #include "MainFrame.h" // For IDs
 #include "KeyCaptureDialog.h"
+#include "../audio/AudioEngine.h"
+#include <cmath>
 
 enum {
     ID_HOTKEY_LIST = 20001,
     ID_BTN_EDIT_HOTKEY,
     ID_BTN_RESET_SELECTED,
-    ID_BTN_RESET_DEFAULTS
+    ID_BTN_RESET_DEFAULTS,
+    ID_BTN_CLEAR_SKIN
 };
 
 wxBEGIN_EVENT_TABLE(SettingsDialog, wxDialog)
@@ -17,8 +20,9 @@ wxBEGIN_EVENT_TABLE(SettingsDialog, wxDialog)
     EVT_BUTTON(ID_BTN_RESET_DEFAULTS, SettingsDialog::OnResetDefaults)
 wxEND_EVENT_TABLE()
 
-SettingsDialog::SettingsDialog(wxWindow* parent)
-    : wxDialog(parent, wxID_ANY, "Settings", wxDefaultPosition, wxSize(600, 450), wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER)
+SettingsDialog::SettingsDialog(wxWindow* parent, AudioEngine* audioEngine)
+    : wxDialog(parent, wxID_ANY, "Settings", wxDefaultPosition, wxSize(600, 450), wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER),
+      audioEngine(audioEngine)
 {
     CreateControls();
     CenterOnParent();
@@ -34,6 +38,14 @@ void SettingsDialog::CreateControls()
     BuildThemeTab(themePanel);
     notebook->AddPage(themePanel, "Theme");
     
+    wxPanel* audioPanel = new wxPanel(notebook);
+    BuildAudioTab(audioPanel);
+    notebook->AddPage(audioPanel, "Audio");
+    
+    wxPanel* samplesPanel = new wxPanel(notebook);
+    BuildSamplesTab(samplesPanel);
+    notebook->AddPage(samplesPanel, "Samples");
+    
     wxPanel* hotkeysPanel = new wxPanel(notebook);
     BuildHotkeysTab(hotkeysPanel);
     notebook->AddPage(hotkeysPanel, "Hotkeys");
@@ -71,6 +83,207 @@ void SettingsDialog::BuildThemeTab(wxWindow* parent)
     parent->SetSizer(sizer);
 }
 
+void SettingsDialog::BuildAudioTab(wxWindow* parent)
+{
+    wxBoxSizer* sizer = new wxBoxSizer(wxVERTICAL);
+    
+    wxStaticBoxSizer* group = new wxStaticBoxSizer(wxVERTICAL, parent, "Output Device");
+    wxFlexGridSizer* grid = new wxFlexGridSizer(2, 5, 10);
+    grid->AddGrowableCol(1);
+    
+    backendChoice = new wxChoice(parent, wxID_ANY);
+    deviceChoice = new wxChoice(parent, wxID_ANY);
+    sampleRateChoice = new wxChoice(parent, wxID_ANY);
+    bufferSizeChoice = new wxChoice(parent, wxID_ANY);
+    
+    grid->Add(new wxStaticText(parent, wxID_ANY, "Backend:"), 0, wxALIGN_CENTER_VERTICAL);
+    grid->Add(backendChoice, 1, wxEXPAND);
+    grid->Add(new wxStaticText(parent, wxID_ANY, "Device:"), 0, wxALIGN_CENTER_VERTICAL);
+    grid->Add(deviceChoice, 1, wxEXPAND);
+    grid->Add(new wxStaticText(parent, wxID_ANY, "Sample rate:"), 0, wxALIGN_CENTER_VERTICAL);
+    grid->Add(sampleRateChoice, 1, wxEXPAND);
+    grid->Add(new wxStaticText(parent, wxID_ANY, "Buffer size:"), 0, wxALIGN_CENTER_VERTICAL);
+    grid->Add(bufferSizeChoice, 1, wxEXPAND);
+    
+    group->Add(grid, 0, wxEXPAND | wxALL, 5);
+    
+    wxStaticBoxSizer* latencyGroup = new wxStaticBoxSizer(wxVERTICAL, parent, "Latency Compensation");
+    wxStaticText* lblInfo = new wxStaticText(parent, wxID_ANY,
+        "The playhead is delayed by the device's output latency.\n"
+        "Use the trim to fine-tune hitsounds by ear; positive values play them earlier.\n"
+        "The trim also applies to exported audio.");
+    
+    wxBoxSizer* trimSizer = new wxBoxSizer(wxHORIZONTAL);
+    latencyTrimSpin = new wxSpinCtrl(parent, wxID_ANY, "", wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, -250, 250, 0);
+    trimSizer->Add(new wxStaticText(parent, wxID_ANY, "Trim (ms):"), 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 5);
+    trimSizer->Add(latencyTrimSpin, 0);
+    
+    lblLatency = new wxStaticText(parent, wxID_ANY, "");
+    
+    latencyGroup->Add(lblInfo, 0, wxALL, 5);
+    latencyGroup->Add(trimSizer, 0, wxALL, 5);
+    latencyGroup->Add(lblLatency, 0, wxALL, 5);
+    
+    sizer->Add(group, 0, wxEXPAND | wxALL, 10);
+    sizer->Add(latencyGroup, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
+    
+    parent->SetSizer(sizer);
+    
+    for (wxChoice* choice : { backendChoice, deviceChoice, sampleRateChoice, bufferSizeChoice })
+        choice->Bind(wxEVT_CHOICE, &SettingsDialog::OnDeviceSettingChanged, this);
+    latencyTrimSpin->Bind(wxEVT_SPINCTRL, [this](wxSpinEvent&) { UpdateLatencyLabel(); });
+    
+    PopulateDeviceControls();
+}
+
+void SettingsDialog::PopulateDeviceControls()
+{
+    if (!audioEngine) return;
+    
+    AudioDeviceSettings current = audioEngine->GetDeviceSettings();
+    auto toWx = [](const juce::String& s) { return wxString::FromUTF8(s.toRawUTF8()); };
+    
+    backendChoice->Clear();
+    for (const auto& type : audioEngine->GetDeviceTypes())
+        backendChoice->Append(toWx(type));
+    backendChoice->SetStringSelection(toWx(current.deviceType));
+    
+    deviceChoice->Clear();
+    for (const auto& name : audioEngine->GetOutputDevices())
+        deviceChoice->Append(toWx(name));
+    deviceChoice->SetStringSelection(toWx(current.outputDevice));
+    
+    sampleRateChoice->Clear();
+    sampleRates.clear();
+    for (double rate : audioEngine->GetAvailableSampleRates()) {
+        sampleRates.push_back(rate);
+        sampleRateChoice->Append(wxString::Format("%.0f Hz", rate));
+        if (rate == current.sampleRate)
+            sampleRateChoice->SetSelection((int)sampleRates.size() - 1);
+    }
+    
+    bufferSizeChoice->Clear();
+    bufferSizes.clear();
+    for (int size : audioEngine->GetAvailableBufferSizes()) {
+        bufferSizes.push_back(size);
+        double ms = current.sampleRate > 0.0 ? size * 1000.0 / current.sampleRate : 0.0;
+        bufferSizeChoice->Append(wxString::Format("%d samples (%.1f ms)", size, ms));
+        if (size == current.bufferSize)
+            bufferSizeChoice->SetSelection((int)bufferSizes.size() - 1);
+    }
+    
+    UpdateLatencyLabel();
+}
+
+void SettingsDialog::UpdateLatencyLabel()
+{
+    if (!audioEngine) return;
+    
+    double latencyMs = audioEngine->GetOutputLatency() * 1000.0;
+    lblLatency->SetLabel(wxString::Format("Output latency: %.1f ms\nHitsound offset: %+d ms", latencyMs, latencyTrimSpin->GetValue()));
+}
+
+void SettingsDialog::OnDeviceSettingChanged(wxCommandEvent& evt)
+{
+    auto toJuce = [](const wxString& s) { return juce::String::fromUTF8(s.utf8_str()); };
+    
+    // A new backend or device starts from its own defaults; rates and buffer
+    // sizes only mean something for the device they were listed for
+    AudioDeviceSettings settings;
+    settings.deviceType = toJuce(backendChoice->GetStringSelection());
+    
+    if (evt.GetEventObject() != backendChoice) {
+        settings.outputDevice = toJuce(deviceChoice->GetStringSelection());
+        
+        if (evt.GetEventObject() != deviceChoice) {
+            int rateIndex = sampleRateChoice->GetSelection();
+            int sizeIndex = bufferSizeChoice->GetSelection();
+            if (rateIndex != wxNOT_FOUND) settings.sampleRate = sampleRates[rateIndex];
+            if (sizeIndex != wxNOT_FOUND) settings.bufferSize = bufferSizes[sizeIndex];
+        }
+    }
+    
+    juce::Result result = audioEngine->SetDeviceSettings(settings);
+    if (result.failed())
+        wxMessageBox(wxString::FromUTF8(result.getErrorMessage().toRawUTF8()), "Audio Device", wxICON_WARNING, this);
+    
+    PopulateDeviceControls();
+}
+
+void SettingsDialog::SetLatencyTrimMs(int ms)
+{
+    latencyTrimSpin->SetValue(ms);
+    UpdateLatencyLabel();
+}
+
+int SettingsDialog::GetLatencyTrimMs() const
+{
+    return latencyTrimSpin->GetValue();
+}
+
+void SettingsDialog::BuildSamplesTab(wxWindow* parent)
+{
+    wxBoxSizer* sizer = new wxBoxSizer(wxVERTICAL);
+    
+    wxStaticBoxSizer* group = new wxStaticBoxSizer(wxVERTICAL, parent, "Skin");
+    wxStaticText* lblInfo = new wxStaticText(parent, wxID_ANY,
+        "Hitsounds missing from the beatmap folder are taken from this osu! skin,\n"
+        "then from the built-in samples, the same way osu! plays them.");
+    
+    wxBoxSizer* rowSizer = new wxBoxSizer(wxHORIZONTAL);
+    skinFolderPicker = new wxDirPickerCtrl(parent, wxID_ANY, "", "Select osu! Skin Folder",
+                                           wxDefaultPosition, wxDefaultSize, wxDIRP_USE_TEXTCTRL | wxDIRP_DIR_MUST_EXIST);
+    wxButton* btnClear = new wxButton(parent, ID_BTN_CLEAR_SKIN, "Clear");
+    btnClear->Bind(wxEVT_BUTTON, [this](wxCommandEvent&) { skinFolderPicker->SetPath(""); });
+    
+    rowSizer->Add(skinFolderPicker, 1, wxRIGHT, 5);
+    rowSizer->Add(btnClear, 0);
+    
+    group->Add(lblInfo, 0, wxALL, 5);
+    group->Add(rowSizer, 0, wxEXPAND | wxALL, 5);
+    
+    wxStaticBoxSizer* cacheGroup = new wxStaticBoxSizer(wxVERTICAL, parent, "Sample Cache");
+    wxBoxSizer* budgetSizer = new wxBoxSizer(wxHORIZONTAL);
+    cacheBudgetSpin = new wxSpinCtrl(parent, wxID_ANY, "", wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 32, 8192, 256);
+    budgetSizer->Add(new wxStaticText(parent, wxID_ANY, "Memory budget (MB):"), 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 5);
+    budgetSizer->Add(cacheBudgetSpin, 0);
+    
+    lblCacheStats = new wxStaticText(parent, wxID_ANY, "");
+    
+    cacheGroup->Add(budgetSizer, 0, wxALL, 5);
+    cacheGroup->Add(lblCacheStats, 0, wxALL, 5);
+    
+    sizer->Add(group, 0, wxEXPAND | wxALL, 10);
+    sizer->Add(cacheGroup, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
+    
+    parent->SetSizer(sizer);
+}
+
+void SettingsDialog::SetSkinFolder(const wxString& path)
+{
+    skinFolderPicker->SetPath(path);
+}
+
+wxString SettingsDialog::GetSkinFolder() const
+{
+    return skinFolderPicker->GetPath();
+}
+
+void SettingsDialog::SetSampleCacheBudget(int megabytes)
+{
+    cacheBudgetSpin->SetValue(megabytes);
+}
+
+int SettingsDialog::GetSampleCacheBudget() const
+{
+    return cacheBudgetSpin->GetValue();
+}
+
+void SettingsDialog::SetSampleCacheStats(const wxString& text)
+{
+    lblCacheStats->SetLabel(text);
+}
+
 void SettingsDialog::BuildHotkeysTab(wxWindow* parent)
 {
     wxBoxSizer* sizer = new wxBoxSizer(wxVERTICAL);
@@ -2,23 +2,62 @@
 #include <wx/wx.h>
 #include <wx/notebook.h>
 #include <wx/listctrl.h>
+#include <wx/filepicker.h>
+#include <wx/spinctrl.h>
+#include <vector>
+
+class AudioEngine;
 
 class SettingsDialog : public wxDialog
 {
 public:
-    SettingsDialog(wxWindow* parent);
+    // Device changes on the Audio tab are applied to the engine straight away
+    SettingsDialog(wxWindow* parent, AudioEngine* audioEngine);
+
+    // Added to the device's output latency to give the playback offset
+    void SetLatencyTrimMs(int ms);
+    int GetLatencyTrimMs() const;
+
+    // osu! skin folder searched for hitsounds the beatmap doesn't provide (empty = none)
+    void SetSkinFolder(const wxString& path);
+    wxString GetSkinFolder() const;
+
+    // Memory budget for decoded custom samples, in megabytes
+    void SetSampleCacheBudget(int megabytes);
+    int GetSampleCacheBudget() const;
+    void SetSampleCacheStats(const wxString& text);
 
 private:
     void CreateControls();
     void BuildThemeTab(wxWindow* parent);
+    void BuildAudioTab(wxWindow* parent);
+    void BuildSamplesTab(wxWindow* parent);
     void BuildHotkeysTab(wxWindow* parent);
     
+    void PopulateDeviceControls();
+    void UpdateLatencyLabel();
+    void OnDeviceSettingChanged(wxCommandEvent& evt);
+
     void PopulateHotkeys();
     void OnHotkeySelected(wxListEvent& evt);
     void OnEditHotkey(wxCommandEvent& evt);
     void OnResetSelected(wxCommandEvent& evt);
     void OnResetDefaults(wxCommandEvent& evt);
 
+    AudioEngine* audioEngine;
+    wxChoice* backendChoice;
+    wxChoice* deviceChoice;
+    wxChoice* sampleRateChoice;
+    wxChoice* bufferSizeChoice;
+    wxSpinCtrl* latencyTrimSpin;
+    wxStaticText* lblLatency;
+    std::vector<double> sampleRates;  // Parallel to sampleRateChoice
+    std::vector<int> bufferSizes;     // Parallel to bufferSizeChoice
+
+    wxDirPickerCtrl* skinFolderPicker;
+    wxSpinCtrl* cacheBudgetSpin;
+    wxStaticText* lblCacheStats;
+
     wxListCtrl* hotkeyList;
     wxButton* btnEditHotkey;
     wxButton* btnResetSelected;
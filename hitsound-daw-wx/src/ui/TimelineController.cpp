@@ -11,6 +11,7 @@ TimelineController::TimelineController()
 void TimelineController::SetProject(Project* p)
 {
     project = p;
+    if (project) project->InvalidateIndex();
     selection.clear();
     baseSelection.clear();
     lastFocusedTrackId = 0;
@@ -46,14 +47,14 @@ void TimelineController::SelectAll()
         {
             for (Track& child : t->children)
             {
-                for (const auto& evt : child.events)
-                    selection.insert({child.id, evt.id});
+                for (size_t i = 0; i < child.events.size(); ++i)
+                    selection.insert({child.id, child.events.Id(i)});
             }
         }
         else
         {
-            for (const auto& evt : t->events)
-                selection.insert({t->id, evt.id});
+            for (size_t i = 0; i < t->events.size(); ++i)
+                selection.insert({t->id, t->events.Id(i)});
         }
     }
 
@@ -112,7 +113,7 @@ int TimelineController::FindRowIndex(Track* t, const std::vector<Track*>& visibl
 
 void TimelineController::CopySelection(const std::vector<Track*>& visibleTracks)
 {
-    if (selection.empty()) return;
+    if (!project || selection.empty()) return;
 
     clipboard.clear();
 
@@ -122,41 +123,27 @@ void TimelineController::CopySelection(const std::vector<Track*>& visibleTracks)
     // Find minimum time and row for relative positioning
     for (const auto& sel : selection)
     {
-        Track* track = FindTrackById(sel.first);
-        if (!track) continue;
+        Track* track = nullptr;
+        auto evt = project->FindEvent(sel.second, &track);
+        if (!evt) continue;
 
-        for (const auto& evt : track->events)
-        {
-            if (evt.id == sel.second)
-            {
-                int row = FindRowIndex(track, visibleTracks);
-                if (evt.time < minTime) minTime = evt.time;
-                if (row < minRow) minRow = row;
-                break;
-            }
-        }
+        int row = FindRowIndex(track, visibleTracks);
+        if (evt->time < minTime) minTime = evt->time;
+        if (row < minRow) minRow = row;
     }
 
     // Create clipboard items with relative positions
     for (const auto& sel : selection)
     {
-        Track* track = FindTrackById(sel.first);
-        if (!track) continue;
-
-        for (const auto& evt : track->events)
-        {
-            if (evt.id == sel.second)
-            {
-                int row = FindRowIndex(track, visibleTracks);
-
-                ClipboardItem item;
-                item.evt = evt;
-                item.relativeRow = row - minRow;
-                item.relativeTime = evt.time - minTime;
-                clipboard.push_back(item);
-                break;
-            }
-        }
+        Track* track = nullptr;
+        auto evt = project->FindEvent(sel.second, &track);
+        if (!evt) continue;
+
+        ClipboardItem item;
+        item.evt = *evt;
+        item.relativeRow = FindRowIndex(track, visibleTracks) - minRow;
+        item.relativeTime = evt->time - minTime;
+        clipboard.push_back(item);
     }
 }
 
@@ -199,6 +186,7 @@ void TimelineController::PasteAtPlayhead(double playheadTime, const std::vector<
         if (!actualTarget) continue;
 
         Event newEvt = ci.evt;
+        newEvt.id = g_nextEventId++;
         newEvt.time = playheadTime + ci.relativeTime;
 
         itemsToPaste.push_back({actualTarget, newEvt});
@@ -207,33 +195,25 @@ void TimelineController::PasteAtPlayhead(double playheadTime, const std::vector<
     if (!itemsToPaste.empty())
     {
         auto refreshFn = [this](){ ValidateHitsounds(); if (OnDataChanged) OnDataChanged(); };
-        undoManager.PushCommand(std::make_unique<PasteEventsCommand>(itemsToPaste,
+        undoManager.PushCommand(std::make_unique<PasteEventsCommand>(project, itemsToPaste,
             [](const std::vector<Track*>&){}, refreshFn));
     }
 }
 
 void TimelineController::DeleteSelection()
 {
-    if (selection.empty()) return;
+    if (!project || selection.empty()) return;
 
     std::vector<RemoveEventsCommand::Item> items;
     for (const auto& sel : selection)
     {
-        Track* track = FindTrackById(sel.first);
-        if (!track) continue;
-
-        for (const auto& evt : track->events)
-        {
-            if (evt.id == sel.second)
-            {
-                items.push_back({track, evt});
-                break;
-            }
-        }
+        Track* track = nullptr;
+        if (auto evt = project->FindEvent(sel.second, &track))
+            items.push_back({track, *evt});
     }
 
     auto refreshFn = [this](){ selection.clear(); ValidateHitsounds(); if (OnDataChanged) OnDataChanged(); };
-    undoManager.PushCommand(std::make_unique<RemoveEventsCommand>(items, refreshFn));
+    undoManager.PushCommand(std::make_unique<RemoveEventsCommand>(project, items, refreshFn));
 }
 
 // Event placement
@@ -250,29 +230,7 @@ void TimelineController::PlaceEvent(Track* target, double time, std::optional<Sa
 
     if (isAddition && defaultHitnormalBank.has_value())
     {
-        // Check if hitnormal already exists at this time
-        bool hitnormalExists = false;
-        for (auto& t : project->tracks)
-        {
-            if (t.sampleType == SampleType::HitNormal)
-            {
-                for (auto& child : t.children)
-                {
-                    for (const auto& e : child.events)
-                    {
-                        if (std::abs(e.time - time) < 0.0005)
-                        {
-                            hitnormalExists = true;
-                            break;
-                        }
-                    }
-                    if (hitnormalExists) break;
-                }
-            }
-            if (hitnormalExists) break;
-        }
-
-        if (!hitnormalExists)
+        if (!project->HasHitnormalAt(time))
         {
             Track* hnTrack = FindOrCreateHitnormalTrack(*defaultHitnormalBank, target->gain);
             if (hnTrack)
@@ -287,14 +245,14 @@ void TimelineController::PlaceEvent(Track* target, double time, std::optional<Sa
                 };
 
                 auto refreshFn = [this](){ ValidateHitsounds(); if (OnDataChanged) OnDataChanged(); if (OnTracksModified) OnTracksModified(); };
-                undoManager.PushCommand(std::make_unique<AddMultipleEventsCommand>(items, refreshFn));
+                undoManager.PushCommand(std::make_unique<AddMultipleEventsCommand>(project, items, refreshFn));
                 return;
             }
         }
     }
 
     auto refreshFn = [this](){ ValidateHitsounds(); if (OnDataChanged) OnDataChanged(); };
-    undoManager.PushCommand(std::make_unique<AddEventCommand>(target, newEvt, refreshFn));
+    undoManager.PushCommand(std::make_unique<AddEventCommand>(project, target, newEvt, refreshFn));
 }
 
 // Undo/Redo
@@ -349,7 +307,7 @@ void TimelineController::ValidateHitsounds()
 {
     if (project)
     {
-        ProjectValidator::Validate(*project);
+        ProjectValidator::ValidateChanges(*project);
     }
 }
 
@@ -358,18 +316,7 @@ void TimelineController::ValidateHitsounds()
 Track* TimelineController::FindTrackById(uint64_t id)
 {
     if (!project || id == 0) return nullptr;
-
-    std::function<Track*(std::vector<Track>&)> search = [&](std::vector<Track>& tracks) -> Track* {
-        for (auto& t : tracks)
-        {
-            if (t.id == id) return &t;
-            Track* found = search(t.children);
-            if (found) return found;
-        }
-        return nullptr;
-    };
-
-    return search(project->tracks);
+    return project->FindTrack(id);
 }
 
 Track* TimelineController::FindOrCreateHitnormalTrack(SampleSet bank, double volume)
@@ -412,6 +359,7 @@ Track* TimelineController::FindOrCreateHitnormalTrack(SampleSet bank, double vol
 
     parent.children.push_back(child);
     project->tracks.push_back(parent);
+    project->InvalidateIndex();
 
     if (OnTracksModified) OnTracksModified();
 
@@ -33,6 +33,7 @@ TimelineView::TimelineView(wxWindow* parent)
 void TimelineView::SetProject(Project* p)
 {
     project = p;
+    if (project) project->InvalidateIndex();
     UpdateVirtualSize();
     ValidateHitsounds();
     Refresh();
@@ -44,9 +45,9 @@ void TimelineView::SetPlayheadPosition(double time)
     Refresh();
 }
 
-void TimelineView::SetWaveform(const std::vector<float>& peaks, double duration)
+void TimelineView::SetWaveform(std::shared_ptr<const WaveformPyramid> pyramid, double duration)
 {
-    waveformPeaks = peaks;
+    waveform = std::move(pyramid);
     audioDuration = duration;
     UpdateVirtualSize();
     Refresh();
@@ -95,31 +96,46 @@ void TimelineView::DrawMasterTrack(wxDC& dc, const wxSize& size, int viewStartPx
     dc.DrawRectangle(0, masterY, size.x, masterTrackHeight);
     
     
-    if (!waveformPeaks.empty() && audioDuration > 0)
+    if (waveform && waveform->getSampleRate() > 0 && audioDuration > 0)
     {
-        dc.SetPen(wxPen(wxColour(100, 150, 200), 1));
-        
         int centerY = masterY + masterTrackHeight / 2;
         float heightScale = masterTrackHeight / 2.0f;
         
+        // Pick the coarsest level that still resolves a pixel, then fold its bins per column
+        double samplesPerPixel = waveform->getSampleRate() / pixelsPerSecond;
+        int level = WaveformPyramid::chooseLevel(samplesPerPixel);
+        double binsPerPixel = samplesPerPixel / WaveformPyramid::samplesPerBin[level];
+        int numReady = waveform->getNumReadyBins(level);
+        
         double totalWidth = audioDuration * pixelsPerSecond;
-        double samplesPerPixel = (double)waveformPeaks.size() / totalWidth;
+        int startX = std::max(0, viewStartPx);
+        int endX = std::min((int)totalWidth, viewEndPx);
+        
+        wxPen peakPen(wxColour(100, 150, 200), 1);
+        wxPen rmsPen(wxColour(160, 200, 240), 1);
         
-        if (samplesPerPixel > 0)
+        for (int x = startX; x < endX; ++x)
         {
-            int startX = std::max(0, viewStartPx);
-            int endX = std::min((int)totalWidth, viewEndPx);
+            int firstBin = (int)(x * binsPerPixel);
+            int lastBin = std::max(firstBin + 1, (int)((x + 1) * binsPerPixel));
+            if (firstBin >= numReady) break;
+            lastBin = std::min(lastBin, numReady);
             
-            for (int x = startX; x < endX; ++x)
+            float lo = 0.0f, hi = 0.0f, rms = 0.0f;
+            for (int i = firstBin; i < lastBin; ++i)
             {
-                int infoIndex = (int)(x * samplesPerPixel);
-                if (infoIndex >= 0 && infoIndex < (int)waveformPeaks.size())
-                {
-                    float val = waveformPeaks[infoIndex];
-                    int h = (int)(val * heightScale);
-                    dc.DrawLine(x, centerY - h, x, centerY + h);
-                }
+                const auto& bin = waveform->getBin(level, i);
+                lo = std::min(lo, bin.min);
+                hi = std::max(hi, bin.max);
+                rms = std::max(rms, bin.rms);
             }
+            
+            dc.SetPen(peakPen);
+            dc.DrawLine(x, centerY - (int)(hi * heightScale), x, centerY - (int)(lo * heightScale) + 1);
+            
+            int r = (int)(rms * heightScale);
+            dc.SetPen(rmsPen);
+            dc.DrawLine(x, centerY - r, x, centerY + r + 1);
         }
     }
 }
@@ -247,21 +263,21 @@ void TimelineView::DrawEvents(wxDC& dc, const std::vector<Track*>& visibleTracks
         
         if (!isParentExpanded)
         {
-            auto drawEventList = [&](const std::vector<Event>& events, Track* srcTrack, wxColour color) {
+            auto drawEventList = [&](Track* srcTrack, wxColour color) {
                 dc.SetPen(*wxTRANSPARENT_PEN);
                 
-                for (int i = 0; i < (int)events.size(); ++i)
+                const auto& events = srcTrack->events;
+                size_t end = events.UpperBound(visEnd + 0.5);
+                for (size_t i = events.LowerBound(visStart - 0.5); i < end; ++i)
                 {
-                    const auto& event = events[i];
-                    if (event.time < visStart - 0.5 || event.time > visEnd + 0.5) continue;
-                    int x = timeToX(event.time);
-                    
+                    int x = timeToX(events.Time(i));
+                    ValidationState state = events.Validation(i);
                     
-                    bool isSelected = selection.count({srcTrack->id, event.id}) > 0;
+                    bool isSelected = selection.count({srcTrack->id, events.Id(i)}) > 0;
                     
                     if (isSelected)
                     {
-                        switch (event.validationState) {
+                        switch (state) {
                             case ValidationState::Invalid:
                                 dc.SetBrush(wxBrush(wxColour(255, 165, 0)));
                                 break;
@@ -275,7 +291,7 @@ void TimelineView::DrawEvents(wxDC& dc, const std::vector<Track*>& visibleTracks
                     }
                     else
                     {
-                        switch (event.validationState) {
+                        switch (state) {
                             case ValidationState::Invalid:
                                 dc.SetBrush(wxBrush(wxColour(255, 50, 50)));
                                 break;
@@ -303,12 +319,12 @@ void TimelineView::DrawEvents(wxDC& dc, const std::vector<Track*>& visibleTracks
             {
                 for (Track& child : track->children)
                 {
-                    drawEventList(child.events, &child, wxColour(100, 200, 255, 100));
+                    drawEventList(&child, wxColour(100, 200, 255, 100));
                 }
             }
             else
             {
-                drawEventList(track->events, track, wxColour(100, 200, 255));
+                drawEventList(track, wxColour(100, 200, 255));
             }
         }
         
@@ -475,32 +491,10 @@ void TimelineView::PlaceEvent(Track* target, double time)
         
         if (hitnormalTrack) {
             
-            bool hitnormalExists = false;
-            for (auto& track : project->tracks) {
-                if (track.sampleType != SampleType::HitNormal) continue;
-                
-                for (const auto& evt : track.events) {
-                    if (std::abs(evt.time - time) < 0.001) {
-                        hitnormalExists = true;
-                        break;
-                    }
-                }
-                if (hitnormalExists) break;
-                
-                for (auto& child : track.children) {
-                    for (const auto& evt : child.events) {
-                        if (std::abs(evt.time - time) < 0.001) {
-                            hitnormalExists = true;
-                            break;
-                        }
-                    }
-                    if (hitnormalExists) break;
-                }
-                if (hitnormalExists) break;
-            }
+            bool hitnormalExists = project->HasHitnormalAt(time);
             
             if (hitnormalExists) {
-                controller.GetUndoManager().PushCommand(std::make_unique<AddEventCommand>(target, newEvent, refreshFn));
+                controller.GetUndoManager().PushCommand(std::make_unique<AddEventCommand>(project, target, newEvent, refreshFn));
             } else {
                 Event hnEvent;
                 hnEvent.time = time;
@@ -509,13 +503,13 @@ void TimelineView::PlaceEvent(Track* target, double time)
                 items.push_back({hitnormalTrack, hnEvent});
                 items.push_back({target, newEvent});
                 
-                controller.GetUndoManager().PushCommand(std::make_unique<AddMultipleEventsCommand>(items, refreshFn));
+                controller.GetUndoManager().PushCommand(std::make_unique<AddMultipleEventsCommand>(project, items, refreshFn));
             }
             return;
         }
     }
     
-    controller.GetUndoManager().PushCommand(std::make_unique<AddEventCommand>(target, newEvent, refreshFn));
+    controller.GetUndoManager().PushCommand(std::make_unique<AddEventCommand>(project, target, newEvent, refreshFn));
 }
 
 
@@ -559,7 +553,7 @@ void TimelineView::HandleLeftDown(wxMouseEvent& evt, const wxPoint& pos)
     if (hit.isValid())
     {
         
-        std::pair<uint64_t, uint64_t> selId = {hit.logicalTrack->id, hit.logicalTrack->events[hit.eventIndex].id};
+        std::pair<uint64_t, uint64_t> selId = {hit.logicalTrack->id, hit.logicalTrack->events.Id(hit.eventIndex)};
         
         if (!ctrl && selection.find(selId) == selection.end())
         {
@@ -610,28 +604,21 @@ void TimelineView::HandleLeftDown(wxMouseEvent& evt, const wxPoint& pos)
                 if (rowIndex == -1) rowIndex = 0;
                 
                 
-                std::vector<int> indices;
-                for (uint64_t eventId : pair.second) {
-                    for (int i = 0; i < (int)t->events.size(); ++i) {
-                        if (t->events[i].id == eventId) {
-                            indices.push_back(i);
-                            break;
-                        }
-                    }
-                }
-                std::sort(indices.rbegin(), indices.rend());
-
-                for (int idx : indices)
+                for (uint64_t eventId : pair.second)
                 {
+                    Track* owner = nullptr;
+                    auto e = project->FindEvent(eventId, &owner);
+                    if (!e || owner != t) continue;
+
                     DragGhost g;
-                    g.evt = t->events[idx];
+                    g.evt = *e;
                     g.originalTime = g.evt.time;
                     g.originalTrackId = t->id;
                     g.originalRowIndex = rowIndex;
                     g.targetTrackId = t->id;
                     dragGhosts.push_back(g);
                     
-                    t->events.erase(t->events.begin() + idx);
+                    project->EraseEvent(*t, g.evt);
                 }
             }
             selection.clear(); 
@@ -700,12 +687,7 @@ void TimelineView::HandleDragging(wxMouseEvent& evt, const wxPoint& pos)
             if (std::abs(t - lastPaintedTime) > 0.0001)
             {
                 // Check if an event already exists at 't' for this track to avoid duplicates during painting
-                bool exists = false;
-                for (const auto& evt : target->events) {
-                    if (std::abs(evt.time - t) < 0.001) { exists = true; break; }
-                }
-                
-                if (!exists) {
+                if (!target->events.HasEventNear(t, 0.001)) {
                     PlaceEvent(target, t);
                 }
                 lastPaintedTime = t;
@@ -800,7 +782,7 @@ void TimelineView::HandleLeftUp(wxMouseEvent& evt, const wxPoint& pos)
             
             Event origEvt = g.evt;
             origEvt.time = g.originalTime; 
-            origTrack->events.push_back(origEvt);
+            project->InsertEvent(*origTrack, origEvt);
         }
         
         
@@ -820,18 +802,13 @@ void TimelineView::HandleLeftUp(wxMouseEvent& evt, const wxPoint& pos)
         }
         
         auto refreshFn = [this](){ ValidateHitsounds(); Refresh(); };
-        controller.GetUndoManager().PushCommand(std::make_unique<MoveEventsCommand>(moves, refreshFn));
+        controller.GetUndoManager().PushCommand(std::make_unique<MoveEventsCommand>(project, moves, refreshFn));
         
         
         selection.clear();
         for (auto& m : moves) {
-            
-            for (const auto& evt : m.newTrack->events) {
-                if (evt.id == m.newEvent.id) {
-                    selection.insert({m.newTrack->id, evt.id});
-                    break;
-                }
-            }
+            if (project->FindEvent(m.newEvent.id))
+                selection.insert({m.newTrack->id, m.newEvent.id});
         }
         
         dragGhosts.clear();
@@ -859,7 +836,7 @@ void TimelineView::HandleRightDown(const wxPoint& pos)
             items.push_back({t, t->events[idx]});
             
             auto refreshFn = [this](){ selection.clear(); ValidateHitsounds(); Refresh(); };
-            controller.GetUndoManager().PushCommand(std::make_unique<RemoveEventsCommand>(items, refreshFn));
+            controller.GetUndoManager().PushCommand(std::make_unique<RemoveEventsCommand>(project, items, refreshFn));
         }
     }
 }
@@ -924,31 +901,32 @@ TimelineView::HitResult TimelineView::GetEventAt(const wxPoint& pos)
 
     Track* vt = result.visualTrack;
     
-    for (int i = vt->events.size() - 1; i >= 0; --i)
-    {
-        int x = timeToX(vt->events[i].time);
-        if (pos.x >= x - 2 && pos.x <= x + 6)
+    // Only events within a few pixels of the cursor can be hit; the latest one wins
+    double startTime = xToTime(pos.x - 7);
+    double endTime = xToTime(pos.x + 3);
+    
+    auto findIn = [&](Track* t) {
+        size_t begin = t->events.LowerBound(startTime);
+        for (size_t i = t->events.UpperBound(endTime); i > begin; --i)
         {
-            result.logicalTrack = vt;
-            result.eventIndex = i;
-            return result;
+            int x = timeToX(t->events.Time(i - 1));
+            if (pos.x >= x - 2 && pos.x <= x + 6)
+            {
+                result.logicalTrack = t;
+                result.eventIndex = (int)i - 1;
+                return true;
+            }
         }
-    }
+        return false;
+    };
+    
+    if (findIn(vt)) return result;
     
     if (!vt->isExpanded && !vt->children.empty())
     {
         for (Track& child : vt->children)
         {
-            for (int i = child.events.size() - 1; i >= 0; --i)
-            {
-                int x = timeToX(child.events[i].time);
-                if (pos.x >= x - 2 && pos.x <= x + 6)
-                {
-                    result.logicalTrack = &child;
-                    result.eventIndex = i;
-                    return result;
-                }
-            }
+            if (findIn(&child)) return result;
         }
     }
     return result;
@@ -1012,6 +990,20 @@ void TimelineView::PerformMarqueeSelect(const wxRect& rect)
     std::vector<Track*> visible = GetVisibleTracks();
     int y = headerHeight;
     
+    // Events are 4px wide, so only those a few pixels either side of the rectangle can touch it
+    double startTime = xToTime(rect.GetLeft() - 3);
+    double endTime = xToTime(rect.GetRight() + 3);
+    
+    auto selectIn = [&](Track* t, int rowY, int rowHeight) {
+        size_t end = t->events.UpperBound(endTime);
+        for (size_t i = t->events.LowerBound(startTime); i < end; ++i)
+        {
+            int ex = timeToX(t->events.Time(i));
+            wxRect eventRect(ex - 2, rowY + 2, 4, rowHeight - 4);
+            if (rect.Intersects(eventRect)) selection.insert({t->id, t->events.Id(i)});
+        }
+    };
+    
     for (Track* t : visible)
     {
         int currentHeight = t->isChildTrack ? TrackLayout::ChildTrackHeight : TrackLayout::ParentTrackHeight;
@@ -1022,33 +1014,12 @@ void TimelineView::PerformMarqueeSelect(const wxRect& rect)
             continue;
         }
         
+        selectIn(t, y, currentHeight);
+        
         if (!t->isExpanded && !t->children.empty())
         {
-            for (int i = 0; i < (int)t->events.size(); ++i)
-            {
-                int ex = timeToX(t->events[i].time);
-                wxRect eventRect(ex - 2, y + 2, 4, currentHeight - 4); 
-                if (rect.Intersects(eventRect)) selection.insert({t->id, t->events[i].id});
-            }
-
             for (Track& child : t->children)
-            {
-                for (int i = 0; i < (int)child.events.size(); ++i)
-                {
-                    int ex = timeToX(child.events[i].time);
-                    wxRect eventRect(ex - 2, y + 2, 4, currentHeight - 4);
-                    if (rect.Intersects(eventRect)) selection.insert({child.id, child.events[i].id});
-                }
-            }
-        }
-        else
-        {
-            for (int i = 0; i < (int)t->events.size(); ++i)
-            {
-                int ex = timeToX(t->events[i].time);
-                wxRect eventRect(ex - 2, y + 2, 4, currentHeight - 4); 
-                if (rect.Intersects(eventRect)) selection.insert({t->id, t->events[i].id});
-            }
+                selectIn(&child, y, currentHeight);
         }
         y += currentHeight;
     }
@@ -1132,7 +1103,7 @@ void TimelineView::OnKeyDown(wxKeyEvent& evt)
 
 void TimelineView::CopySelection()
 {
-    if (selection.empty()) return;
+    if (!project || selection.empty()) return;
     
     clipboard.clear();
     
@@ -1156,38 +1127,27 @@ void TimelineView::CopySelection()
     
     for (const auto& sel : selection)
     {
-        Track* track = FindTrackById(sel.first);
-        if (!track) continue;
-        
+        Track* track = nullptr;
+        auto evt = project->FindEvent(sel.second, &track);
+        if (!evt) continue;
         
-        for (const auto& evt : track->events) {
-            if (evt.id == sel.second) {
-                int row = findRowIndex(track);
-                if (evt.time < minTime) minTime = evt.time;
-                if (row < minRow) minRow = row;
-                break;
-            }
-        }
+        int row = findRowIndex(track);
+        if (evt->time < minTime) minTime = evt->time;
+        if (row < minRow) minRow = row;
     }
     
     
     for (const auto& sel : selection)
     {
-        Track* track = FindTrackById(sel.first);
-        if (!track) continue;
+        Track* track = nullptr;
+        auto evt = project->FindEvent(sel.second, &track);
+        if (!evt) continue;
         
-        for (const auto& evt : track->events) {
-            if (evt.id == sel.second) {
-                int row = findRowIndex(track);
-                
-                ClipboardItem item;
-                item.evt = evt;
-                item.relativeRow = row - minRow;
-                item.relativeTime = evt.time - minTime;
-                clipboard.push_back(item);
-                break;
-            }
-        }
+        ClipboardItem item;
+        item.evt = *evt;
+        item.relativeRow = findRowIndex(track) - minRow;
+        item.relativeTime = evt->time - minTime;
+        clipboard.push_back(item);
     }
 }
 
@@ -1208,14 +1168,14 @@ void TimelineView::SelectAll()
         {
             for (Track& child : t->children)
             {
-                for (const auto& evt : child.events)
-                    selection.insert({child.id, evt.id});
+                for (size_t i = 0; i < child.events.size(); ++i)
+                    selection.insert({child.id, child.events.Id(i)});
             }
         }
         else
         {
-            for (const auto& evt : t->events)
-                selection.insert({t->id, evt.id});
+            for (size_t i = 0; i < t->events.size(); ++i)
+                selection.insert({t->id, t->events.Id(i)});
         }
     }
     Refresh();
@@ -1256,6 +1216,7 @@ void TimelineView::PasteAtPlayhead()
         if (!actualTarget) continue;
         
         Event newEvt = ci.evt;
+        newEvt.id = g_nextEventId++;
         newEvt.time = SnapToGrid(playheadPosition + ci.relativeTime);
         
         itemsToPaste.push_back({actualTarget, newEvt});
@@ -1267,30 +1228,24 @@ void TimelineView::PasteAtPlayhead()
             
         };
         auto refreshFn = [this](){ ValidateHitsounds(); Refresh(); };
-        controller.GetUndoManager().PushCommand(std::make_unique<PasteEventsCommand>(itemsToPaste, selCallback, refreshFn));
+        controller.GetUndoManager().PushCommand(std::make_unique<PasteEventsCommand>(project, itemsToPaste, selCallback, refreshFn));
     }
 }
 
 void TimelineView::DeleteSelection()
 {
-    if (selection.empty()) return;
+    if (!project || selection.empty()) return;
     
     std::vector<RemoveEventsCommand::Item> items;
     for (const auto& sel : selection)
     {
-        Track* track = FindTrackById(sel.first);
-        if (!track) continue;
-        
-        for (const auto& evt : track->events) {
-            if (evt.id == sel.second) {
-                items.push_back({track, evt});
-                break;
-            }
-        }
+        Track* track = nullptr;
+        if (auto evt = project->FindEvent(sel.second, &track))
+            items.push_back({track, *evt});
     }
     
     auto refreshFn = [this](){ selection.clear(); ValidateHitsounds(); Refresh(); };
-    controller.GetUndoManager().PushCommand(std::make_unique<RemoveEventsCommand>(items, refreshFn));
+    controller.GetUndoManager().PushCommand(std::make_unique<RemoveEventsCommand>(project, items, refreshFn));
 }
 
 
@@ -1390,8 +1345,7 @@ void TimelineView::ValidateHitsounds()
 {
     if (!project) return;
     
-    
-    ProjectValidator::Validate(*project);
+    ProjectValidator::ValidateChanges(*project);
     
     if (OnTracksModified) OnTracksModified();
 }
@@ -1399,17 +1353,7 @@ void TimelineView::ValidateHitsounds()
 Track* TimelineView::FindTrackById(uint64_t id)
 {
     if (!project || id == 0) return nullptr;
-    
-    std::function<Track*(std::vector<Track>&)> search = [&](std::vector<Track>& tracks) -> Track* {
-        for (auto& t : tracks) {
-            if (t.id == id) return &t;
-            Track* found = search(t.children);
-            if (found) return found;
-        }
-        return nullptr;
-    };
-    
-    return search(project->tracks);
+    return project->FindTrack(id);
 }
 
 Track* TimelineView::FindOrCreateHitnormalTrack(SampleSet bank, double volume)
@@ -1438,6 +1382,7 @@ Track* TimelineView::FindOrCreateHitnormalTrack(SampleSet bank, double volume)
         newParent.sampleType = SampleType::HitNormal;
         newParent.isExpanded = false;
         project->tracks.push_back(newParent);
+        project->InvalidateIndex();
         parent = &project->tracks.back();
     }
     
@@ -1454,6 +1399,7 @@ Track* TimelineView::FindOrCreateHitnormalTrack(SampleSet bank, double volume)
     child.gain = volume;
     child.isChildTrack = true;
     parent->children.push_back(child);
+    project->InvalidateIndex();
     
     UpdateVirtualSize();
     Refresh();
@@ -8,6 +8,8 @@
 #include <map>
 #include <algorithm>
 #include "../Constants.h"
+#include "../audio/WaveformPyramid.h"
+#include <memory>
 
 enum class ToolType
 {
@@ -48,7 +50,8 @@ public:
     
     void UpdateVirtualSize();
     
-    void SetWaveform(const std::vector<float>& peaks, double duration);
+    // The pyramid may still be filling in; call again (or Refresh) as bins arrive
+    void SetWaveform(std::shared_ptr<const WaveformPyramid> pyramid, double duration);
 
     
     void Undo() { controller.Undo(); }
@@ -128,7 +131,7 @@ private:
     void PerformMarqueeSelect(const wxRect& rect);
     
     
-    std::vector<float> waveformPeaks;
+    std::shared_ptr<const WaveformPyramid> waveform;
     double audioDuration = 0.0;
 
     
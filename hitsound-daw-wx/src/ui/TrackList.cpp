@@ -4,6 +4,7 @@
 #include "AddTrackDialog.h"
 #include "AddGroupingDialog.h"
 #include "TimelineView.h" 
+#include "../audio/AudioEngine.h"
 #include <wx/dcbuffer.h>
 #include <wx/graphics.h>
 #include <cmath>
@@ -28,6 +29,19 @@ namespace {
     constexpr int kHeaderHeight = TrackLayout::HeaderHeight;
     constexpr int kParentTrackHeight = TrackLayout::ParentTrackHeight;
     constexpr int kChildTrackHeight = TrackLayout::ChildTrackHeight;
+
+    // Level meters: one beside each track's M/S buttons, three in the master header
+    constexpr int kMeterX = 40;
+    constexpr int kMeterWidth = 6;
+    constexpr int kBusMeterWidth = 8;
+    constexpr int kBusMeterGap = 4;
+    constexpr float kMeterFloorDb = -60.0f;
+
+    float MeterFraction(float gain)
+    {
+        float db = 20.0f * std::log10(std::max(gain, 1.0e-6f));
+        return std::clamp((db - kMeterFloorDb) / -kMeterFloorDb, 0.0f, 1.0f);
+    }
 }
 
 
@@ -110,6 +124,74 @@ void TrackList::SetProject(Project* p)
     Refresh();
 }
 
+void TrackList::UpdateMeters()
+{
+    if (!audioEngine || !project) return;
+
+    // Per timer tick: RMS falls quickly, peaks hang a little longer
+    constexpr float rmsRelease = 0.8f;
+    constexpr float peakRelease = 0.93f;
+    const float floor = std::pow(10.0f, kMeterFloorDb / 20.0f);
+
+    auto follow = [&](MeterLevel& shown, const MeterLevel& level) {
+        MeterLevel next { std::max(level.peak, shown.peak * peakRelease), std::max(level.rms, shown.rms * rmsRelease) };
+        if (next.peak < floor) next.peak = 0.0f;
+        if (next.rms < floor) next.rms = 0.0f;
+
+        bool moved = next.peak != shown.peak || next.rms != shown.rms;
+        shown = next;
+        return moved;
+    };
+
+    trackMeters.resize(project->tracks.size());
+
+    bool tracksMoved = false;
+    for (size_t i = 0; i < trackMeters.size(); ++i)
+        tracksMoved |= follow(trackMeters[i], audioEngine->GetTrackLevel((int)i));
+
+    bool busesMoved = false;
+    for (int bus = 0; bus < LevelMeters::numBuses; ++bus)
+        busesMoved |= follow(busMeters[bus], audioEngine->GetBusLevel((LevelMeters::Bus)bus));
+
+    wxSize size = GetClientSize();
+    if (tracksMoved)
+        RefreshRect(wxRect(kMeterX, 0, kMeterWidth, size.GetHeight()), false);
+    if (busesMoved) {
+        wxRect busRect = GetBusMetersRect(size.GetWidth());
+        busRect.Offset(0, -scrollOffsetY);
+        RefreshRect(busRect, false);
+    }
+}
+
+wxRect TrackList::GetBusMetersRect(int width) const
+{
+    int metersWidth = LevelMeters::numBuses * kBusMeterWidth + (LevelMeters::numBuses - 1) * kBusMeterGap;
+    return wxRect(width - 10 - metersWidth, kRulerHeight + 12, metersWidth, kMasterTrackHeight - 30);
+}
+
+void TrackList::DrawMeter(wxDC& dc, const wxRect& rect, const MeterLevel& level)
+{
+    dc.SetPen(*wxTRANSPARENT_PEN);
+    dc.SetBrush(wxBrush(wxColour(30, 30, 30)));
+    dc.DrawRectangle(rect);
+
+    int rmsH = (int)std::lround(MeterFraction(level.rms) * rect.height);
+    if (rmsH > 0) {
+        dc.SetBrush(wxBrush(wxColour(80, 190, 80)));
+        dc.DrawRectangle(rect.x, rect.GetBottom() + 1 - rmsH, rect.width, rmsH);
+    }
+
+    if (level.peak > 0.0f) {
+        // Yellow above -6 dB, red at full scale
+        wxColour peakCol = level.peak >= 1.0f ? wxColour(230, 50, 50)
+                         : level.peak >= 0.5f ? wxColour(230, 200, 60)
+                                              : wxColour(160, 230, 160);
+        int peakY = rect.GetBottom() - (int)std::lround(MeterFraction(level.peak) * (rect.height - 1));
+        dc.SetPen(wxPen(peakCol, 2));
+        dc.DrawLine(rect.x, peakY, rect.GetRight() + 1, peakY);
+    }
+}
+
 void TrackList::SetVerticalScrollOffset(int y)
 {
     scrollOffsetY = y;
@@ -156,6 +238,12 @@ int TrackList::GetTrackHeight(const Track& track)
     return track.isChildTrack ? kChildTrackHeight : kParentTrackHeight;
 }
 
+void TrackList::NotifyTracksModified()
+{
+    // Gain, mute and solo are baked into the playback schedule
+    if (timelineView && timelineView->OnTracksModified) timelineView->OnTracksModified();
+}
+
 
 
 
@@ -248,7 +336,8 @@ void TrackList::DrawHeader(wxDC& dc, int& y, int width)
         masterTitle = wxString::FromUTF8(project->artist) + " - " + wxString::FromUTF8(project->title);
     }
     
-    int maxTitleWidth = width - 30;
+    wxRect busRect = GetBusMetersRect(width);
+    int maxTitleWidth = busRect.x - 20;
     if (dc.GetTextExtent(masterTitle).GetWidth() > maxTitleWidth) {
         while (masterTitle.Length() > 3 && dc.GetTextExtent(masterTitle + "...").GetWidth() > maxTitleWidth) {
             masterTitle = masterTitle.Left(masterTitle.Length() - 1);
@@ -281,6 +370,21 @@ void TrackList::DrawHeader(wxDC& dc, int& y, int width)
     dc.DrawText(bpmStr, 10, masterY + 45);
     dc.DrawText(offsetStr, 10, masterY + 65);
     
+    
+    const char* busLabels[LevelMeters::numBuses] = { "S", "F", "M" };
+    wxFont labelFont = dc.GetFont();
+    labelFont.SetPointSize(7);
+    dc.SetFont(labelFont);
+    
+    for (int bus = 0; bus < LevelMeters::numBuses; ++bus) {
+        wxRect meterRect(busRect.x + bus * (kBusMeterWidth + kBusMeterGap), y + busRect.y, kBusMeterWidth, busRect.height);
+        DrawMeter(dc, meterRect, busMeters[bus]);
+        
+        wxSize tz = dc.GetTextExtent(busLabels[bus]);
+        dc.SetTextForeground(wxColour(200, 200, 200));
+        dc.DrawText(busLabels[bus], meterRect.x + (meterRect.width - tz.x) / 2, meterRect.GetBottom() + 3);
+    }
+    
     y += kHeaderHeight;
 }
 
@@ -619,8 +723,15 @@ void TrackList::OnPaint(wxPaintEvent& evt)
     
     DrawHeader(dc, y, width);
     
-    for (auto& track : project->tracks)
-        DrawTrackRow(dc, track, y, width, 0);
+    for (size_t i = 0; i < project->tracks.size(); ++i) {
+        int rowY = y;
+        DrawTrackRow(dc, project->tracks[i], y, width, 0);
+        
+        if (audioEngine) {
+            MeterLevel level = i < trackMeters.size() ? trackMeters[i] : MeterLevel();
+            DrawMeter(dc, wxRect(kMeterX, rowY + 25, kMeterWidth, 45), level);
+        }
+    }
     
     DrawDropIndicator(dc, width, kHeaderHeight);
 }
@@ -664,6 +775,8 @@ void TrackList::AddChildToTrack(Track* parent)
         Track child;
         child.sampleSet = parent->sampleSet;
         child.sampleType = parent->sampleType;
+        child.sampleIndex = parent->sampleIndex;
+        child.customFilename = parent->customFilename;
         child.gain = 0.5f;
         
         std::string sStr = (child.sampleSet == SampleSet::Normal) ? "normal" : (child.sampleSet == SampleSet::Soft ? "soft" : "drum");
@@ -677,6 +790,7 @@ void TrackList::AddChildToTrack(Track* parent)
         parent->isExpanded = true;
     }
     
+    project->InvalidateIndex();
     if (timelineView) timelineView->UpdateVirtualSize();
     Refresh();
     if (GetParent()) GetParent()->Refresh();
@@ -736,6 +850,10 @@ void TrackList::EditTrack(Track* track)
                     child.sampleType = SampleType::HitNormal;
                 }
                 
+                // Banks decide conflicts at every time, not just the edited ones
+                project->MarkAllChanged();
+                if (timelineView) timelineView->ValidateHitsounds();
+                
                 Refresh();
                 if (GetParent()) GetParent()->Refresh();
             }
@@ -757,6 +875,9 @@ void TrackList::EditTrack(Track* track)
                 track->sampleSet = res.bank;
                 track->sampleType = res.type;
                 
+                project->MarkAllChanged();
+                if (timelineView) timelineView->ValidateHitsounds();
+                
                 Refresh();
                 if (GetParent()) GetParent()->Refresh();
             }
@@ -803,6 +924,7 @@ void TrackList::DeleteTrack(Track* track, Track* parent)
         }
     }
     
+    project->InvalidateIndex();
     Refresh();
     if (GetParent()) GetParent()->Refresh();
     if (timelineView) timelineView->UpdateVirtualSize();
@@ -953,6 +1075,7 @@ bool TrackList::HandleHeaderClick(int clickX, int clickY)
                     parent->children.push_back(child);
                 }
                 
+                project->InvalidateIndex();
                 Refresh();
                 if (timelineView) timelineView->UpdateVirtualSize();
                 if (GetParent()) GetParent()->Refresh();
@@ -995,6 +1118,7 @@ bool TrackList::HandleHeaderClick(int clickX, int clickY)
                 
                 grouping.children.push_back(child);
                 project->tracks.push_back(grouping);
+                project->InvalidateIndex();
                 
                 Refresh();
                 if (timelineView) timelineView->UpdateVirtualSize();
@@ -1034,12 +1158,14 @@ bool TrackList::HandleTrackClick(Track& track, int clickX, int localY, int y, in
         if (clickX >= muteRect.x && clickX <= muteRect.GetRight() &&
             localY >= muteRect.y && localY <= muteRect.GetBottom()) {
             track.mute = !track.mute;
+            NotifyTracksModified();
             Refresh();
             return true;
         }
         if (clickX >= soloRect.x && clickX <= soloRect.GetRight() &&
             localY >= soloRect.y && localY <= soloRect.GetBottom()) {
             track.solo = !track.solo;
+            NotifyTracksModified();
             Refresh();
             return true;
         }
@@ -1063,6 +1189,7 @@ bool TrackList::HandleTrackClick(Track& track, int clickX, int localY, int y, in
             sliderTrack->gain = val;
             
             UpdateTrackNameWithVolume(*sliderTrack, val);
+            NotifyTracksModified();
             Refresh();
             return true;
         }
@@ -1093,6 +1220,7 @@ bool TrackList::HandleTrackClick(Track& track, int clickX, int localY, int y, in
                         Track child = std::move(track.children[idx]);
                         track.children.erase(track.children.begin() + idx);
                         track.children.insert(track.children.begin(), std::move(child));
+                        project->InvalidateIndex();
                     }
                     track.primaryChildIndex = 0;
                 }
@@ -1201,6 +1329,7 @@ void TrackList::OnMouseEvents(wxMouseEvent& evt)
             
             sliderTrack->gain = val;
             UpdateTrackNameWithVolume(*sliderTrack, val);
+            NotifyTracksModified();
             Refresh();
         }
         else if (!isDraggingSlider && dragSourceTrack) {
@@ -1294,6 +1423,7 @@ void TrackList::OnMouseEvents(wxMouseEvent& evt)
                         Track temp = std::move(kids[srcIdx]);
                         kids.erase(kids.begin() + srcIdx);
                         kids.insert(kids.begin() + destIdx, std::move(temp));
+                        project->InvalidateIndex();
                         
                         if (destIdx == 0) currentDropTarget.parent->primaryChildIndex = 0;
                     }
@@ -1314,6 +1444,7 @@ void TrackList::OnMouseEvents(wxMouseEvent& evt)
                         Track temp = std::move(tracks[srcIdx]);
                         tracks.erase(tracks.begin() + srcIdx);
                         tracks.insert(tracks.begin() + destIdx, std::move(temp));
+                        project->InvalidateIndex();
                     }
                 }
             }
@@ -1,9 +1,12 @@
 #pragma once
 #include <wx/wx.h>
 #include "../model/Track.h"
+#include "../audio/LevelMeters.h"
+#include <array>
 
 struct Project;
 class TimelineView;
+class AudioEngine;
 
 class TrackList : public wxPanel
 {
@@ -13,6 +16,11 @@ public:
     void SetProject(Project* p);
     void SetVerticalScrollOffset(int y);
     void SetTimelineView(TimelineView* view) { timelineView = view; }
+    void SetAudioEngine(AudioEngine* engine) { audioEngine = engine; }
+
+    // Polls the engine's level meters and repaints the meters that moved.
+    // Call from the playback timer.
+    void UpdateMeters();
 
     int GetTotalContentHeight() const;
     std::vector<Track*> GetVisibleTracks();
@@ -33,6 +41,8 @@ private:
     void DrawPrimarySelector(wxDC& dc, Track& track, int y, int width);
     void DrawAbbreviation(wxDC& dc, Track& track, int y, int width, int height);
     void DrawDropIndicator(wxDC& dc, int width, int headerHeight);
+    void DrawMeter(wxDC& dc, const wxRect& rect, const MeterLevel& level);
+    wxRect GetBusMetersRect(int width) const;
 
     // Hit testing
     Track* FindTrackAtY(int y, int& outIndent, Track** outParent = nullptr);
@@ -51,11 +61,17 @@ private:
     // Utilities
     static std::pair<std::string, bool> GetAbbreviation(SampleSet s, SampleType t);
     void UpdateTrackNameWithVolume(Track& track, double volume);
+    void NotifyTracksModified();
 
     Project* project = nullptr;
     TimelineView* timelineView = nullptr;
+    AudioEngine* audioEngine = nullptr;
     int scrollOffsetY = 0;
 
+    // Levels as displayed, after peak/RMS release ballistics
+    std::vector<MeterLevel> trackMeters;
+    std::array<MeterLevel, LevelMeters::numBuses> busMeters {};
+
     // Child track volume slider drag state
     bool isDraggingSlider = false;
     Track* sliderTrack = nullptr;
@@ -8,6 +8,8 @@
 #include <wx/settings.h>
 #include <wx/file.h>
 #include <wx/statline.h>
+#include <algorithm>
+#include <cmath>
 
 wxBEGIN_EVENT_TABLE(TransportPanel, wxPanel)
     EVT_BUTTON(1001, TransportPanel::OnPlay)
@@ -88,7 +90,16 @@ TransportPanel::TransportPanel(wxWindow* parent, AudioEngine* engine, TimelineVi
     timeFont.SetPointSize(14);
     timeFont.SetWeight(wxFONTWEIGHT_BOLD);
     lblTime->SetFont(timeFont);
-    mainSizer->Add(lblTime, 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 10);
+    
+    // Song decode progress, only shown while the song is still loading into memory
+    loadGauge = new wxGauge(this, wxID_ANY, 100, wxDefaultPosition, wxSize(-1, 6));
+    loadGauge->SetToolTip("Loading song into memory");
+    loadGauge->Hide();
+    
+    wxBoxSizer* timeSizer = new wxBoxSizer(wxVERTICAL);
+    timeSizer->Add(lblTime, 0);
+    timeSizer->Add(loadGauge, 0, wxEXPAND | wxTOP, 2);
+    mainSizer->Add(timeSizer, 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 10);
     
     
     wxStaticLine* divider = new wxStaticLine(this, wxID_ANY, wxDefaultPosition, wxSize(1, 55), wxLI_VERTICAL);
@@ -153,6 +164,20 @@ TransportPanel::TransportPanel(wxWindow* parent, AudioEngine* engine, TimelineVi
     
     mainSizer->Add(volumeGrid, 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 10);
     
+    // Audio callback load and xruns (see AudioPerformanceMonitor)
+    wxBoxSizer* perfSizer = new wxBoxSizer(wxVERTICAL);
+    
+    lblDsp = new wxStaticText(this, wxID_ANY, "DSP 0%");
+    lblDsp->SetForegroundColour(wxColour(128, 128, 128));
+    dspGauge = new wxGauge(this, wxID_ANY, 100, wxDefaultPosition, wxSize(60, 6));
+    lblXRuns = new wxStaticText(this, wxID_ANY, "XRuns 0");
+    lblXRuns->SetForegroundColour(wxColour(128, 128, 128));
+    
+    perfSizer->Add(lblDsp, 0);
+    perfSizer->Add(dspGauge, 0, wxEXPAND | wxTOP | wxBOTTOM, 2);
+    perfSizer->Add(lblXRuns, 0);
+    mainSizer->Add(perfSizer, 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 10);
+    
     
     
     wxBoxSizer* zoomSizer = new wxBoxSizer(wxVERTICAL);
@@ -201,6 +226,56 @@ void TransportPanel::UpdateTime(double time)
     lblTime->SetLabel(wxString::Format("%02d:%02d:%03d", m, s, mill));
 }
 
+void TransportPanel::UpdateLoadProgress(double progress)
+{
+    bool loading = progress < 1.0;
+    if (loadGauge->IsShown() != loading)
+    {
+        loadGauge->Show(loading);
+        Layout();
+    }
+    
+    if (loading)
+        loadGauge->SetValue((int)(progress * 100.0));
+}
+
+void TransportPanel::UpdatePerformance(const AudioPerformanceStats& stats)
+{
+    int percent = (int)std::lround(std::min(stats.load, 1.0f) * 100.0f);
+    wxString dspText = wxString::Format("DSP %d%%", percent);
+    if (lblDsp->GetLabel() != dspText)
+    {
+        lblDsp->SetLabel(dspText);
+        dspGauge->SetValue(percent);
+    }
+    
+    const float heldPeakLoad = peakLoad.Update(stats.peakLoad);
+    const int heldPeakVoices = peakVoices.Update(stats.peakVoices);
+    
+    wxString tooltip = wxString::Format("Audio callback: %.2f ms last, %.0f%% average, %.0f%% peak\n%d voices peak, %llu callbacks, %llu late",
+                                        stats.lastCallbackMs, stats.load * 100.0f, heldPeakLoad * 100.0f, heldPeakVoices,
+                                        (unsigned long long)stats.numCallbacks, (unsigned long long)stats.numOverruns);
+    if (lblDsp->GetToolTipText() != tooltip)
+        lblDsp->SetToolTip(tooltip);
+    
+    // A single slow callback turns the label red even if the average looks fine
+    wxColour dspColour = heldPeakLoad >= 0.8f ? wxColour(200, 0, 0) : wxColour(128, 128, 128);
+    if (lblDsp->GetForegroundColour() != dspColour)
+    {
+        lblDsp->SetForegroundColour(dspColour);
+        lblDsp->Refresh();
+    }
+    
+    // Late callbacks and driver xruns usually describe the same dropouts, so show the larger count
+    unsigned long long xruns = std::max<unsigned long long>(stats.numOverruns, (unsigned long long)std::max(0, stats.deviceXRuns));
+    wxString xrunText = wxString::Format("XRuns %llu", xruns);
+    if (lblXRuns->GetLabel() != xrunText)
+    {
+        lblXRuns->SetLabel(xrunText);
+        lblXRuns->SetForegroundColour(xruns > 0 ? wxColour(200, 0, 0) : wxColour(128, 128, 128));
+    }
+}
+
 void TransportPanel::SetZoomLevel(double pixelsPerSecond)
 {
     
@@ -6,7 +6,9 @@
 #include <wx/bmpbuttn.h>
 #include <wx/artprov.h>
 #include <wx/slider.h>
+#include <wx/gauge.h>
 #include "../model/SampleTypes.h"
+#include "../audio/AudioPerformanceMonitor.h"
 
 class AudioEngine;
 class TimelineView;
@@ -18,6 +20,8 @@ public:
     TransportPanel(wxWindow* parent, AudioEngine* engine, TimelineView* timeline);
     
     void UpdateTime(double time);
+    void UpdateLoadProgress(double progress);
+    void UpdatePerformance(const AudioPerformanceStats& stats);
     void SetZoomLevel(double pixelsPerSecond);
     void UpdatePlayButton();
     
@@ -67,6 +71,32 @@ private:
     wxBitmap LoadIcon(const std::string& filename, const wxColor& color);
 
     wxStaticText* lblTime;
+    wxGauge* loadGauge;
+
+    wxGauge* dspGauge;
+    wxStaticText* lblDsp;
+    wxStaticText* lblXRuns;
+    
+    // The engine resets its peaks on every read, so they are held here for a
+    // while; otherwise an overload would only show for the one tick that saw it
+    static constexpr int peakHoldTicks = 50;  // About 1.5 s of the 30 ms UI timer
+    
+    template <typename T>
+    struct PeakHold {
+        T value{};
+        int age = 0;
+        
+        T Update(T latest) {
+            if (latest >= value || ++age > peakHoldTicks) {
+                value = latest;
+                age = 0;
+            }
+            return value;
+        }
+    };
+    
+    PeakHold<float> peakLoad;
+    PeakHold<int> peakVoices;
     
     wxDECLARE_EVENT_TABLE();
 };